@@ -1,6 +1,8 @@
 
 
 #include "ddelta.h"
+#include "mismatch.h"
+#include "xxhash.h"
 
 // ------------------------ Delta format (simple, fixed 32-bit fields) ------------------------
 //
@@ -45,36 +47,110 @@ static inline uint8_t read_u8(const uint8_t*& p, const uint8_t* end) {
   return *p++;
 }
 
+static inline uint8_t* put_u32_le(uint8_t* out, uint32_t v) {
+  out[0] = uint8_t(v & 0xFF);
+  out[1] = uint8_t((v >> 8) & 0xFF);
+  out[2] = uint8_t((v >> 16) & 0xFF);
+  out[3] = uint8_t((v >> 24) & 0xFF);
+  return out + 4;
+}
+
 struct Op {
   enum Type : uint8_t { COPY = 0, INSERT = 1 } type;
-  uint32_t off = 0;                 // for COPY
-  std::vector<uint8_t> data;        // for INSERT
+  uint32_t off = 0;                 // COPY: offset in src, INSERT: in tgt
   uint32_t len = 0;                 // for COPY or INSERT length
 };
 
-static inline void merge_or_push(std::vector<Op>& ops, Op&& op) {
+static inline void merge_or_push(std::vector<Op>& ops, const Op& op) {
   if (op.len == 0) return;
 
   if (!ops.empty()) {
     Op& last = ops.back();
-    if (last.type == op.type) {
-      if (op.type == Op::INSERT) {
-        // Merge INSERTs (append data).
-        last.data.insert(last.data.end(), op.data.begin(), op.data.end());
-        last.len += op.len;
-        return;
-      } else {
-        // Merge COPYs only if they are contiguous in src.
-        if (last.off + last.len == op.off) {
-          last.len += op.len;
-          return;
-        }
-      }
+    // Merge COPYs contiguous in src, and INSERTs (always contiguous in tgt).
+    if (last.type == op.type && last.off + last.len == op.off) {
+      last.len += op.len;
+      return;
     }
   }
-  ops.push_back(std::move(op));
+  ops.push_back(op);
 }
 
+// ------------------------ Base string index ------------------------
+//
+// Flat open-addressing multimap fingerprint -> src offset, filled in one pass
+// over the base. Linear probing keeps equal fingerprints in insertion
+// (= ascending offset) order along the probe sequence, so a lookup sees the
+// candidates in the same order as the per-fingerprint offset lists did.
+// The arrays only grow and are kept per thread, so steady-state encodes do
+// not allocate.
+
+class FlatIndex {
+ public:
+  // Empty the index, sized for about @nitems strings.
+  void reset(size_t nitems) {
+    size_t nslots = 64;
+    while (nslots < nitems * 2) nslots <<= 1;
+    if (nslots > keys_.size()) {
+      keys_.resize(nslots);
+      offs_.resize(nslots);
+    }
+    mask_ = nslots - 1;
+    count_ = 0;
+    std::memset(keys_.data(), 0, nslots * sizeof(uint64_t));
+  }
+
+  void insert(uint64_t fp, uint32_t off) {
+    if (++count_ * 2 > mask_ + 1) grow();
+    put(slot_key(fp), off);
+  }
+
+  // Calls fn(off) for every offset stored under fp, oldest first, until fn
+  // returns true.
+  template <typename Fn>
+  bool find(uint64_t fp, Fn&& fn) const {
+    uint64_t key = slot_key(fp);
+    for (size_t i = key & mask_; keys_[i]; i = (i + 1) & mask_) {
+      if (keys_[i] == key && fn(offs_[i])) return true;
+    }
+    return false;
+  }
+
+ private:
+  // 0 marks an empty slot, fold it onto another key
+  static uint64_t slot_key(uint64_t fp) { return fp ? fp : 1; }
+
+  void put(uint64_t key, uint32_t off) {
+    size_t i = key & mask_;
+    while (keys_[i]) i = (i + 1) & mask_;
+    keys_[i] = key;
+    offs_[i] = off;
+  }
+
+  // Only pathological bases (strings of a byte or two) get here. Replaying
+  // the entries by offset restores insertion order for the new table.
+  void grow() {
+    std::vector<std::pair<uint32_t, uint64_t>> items;
+    items.reserve(count_);
+    for (size_t i = 0; i <= mask_; i++) {
+      if (keys_[i]) items.emplace_back(offs_[i], keys_[i]);
+    }
+    std::sort(items.begin(), items.end());
+    size_t nslots = (mask_ + 1) * 2;
+    keys_.assign(nslots, 0);
+    offs_.resize(nslots);
+    mask_ = nslots - 1;
+    for (const auto& it : items) put(it.second, it.first);
+  }
+
+  std::vector<uint64_t> keys_;
+  std::vector<uint32_t> offs_;
+  size_t mask_ = 0;
+  size_t count_ = 0;
+};
+
+static thread_local FlatIndex base_index;
+static thread_local std::vector<Op> op_list;
+
 // ------------------------ Gear chunking using MSB 5-bit mask ------------------------
 //
 // We use a 32-bit rolling "fp":
@@ -86,63 +162,54 @@ static inline void merge_or_push(std::vector<Op>& ops, Op&& op) {
 // Probability 1/32 => expected ~32 bytes per string.
 
 static constexpr uint32_t kMaskMSB5 = 0xF8000000u;
-static constexpr uint32_t kPattern  = 0x00000000u;
 
 // Safety cap to avoid pathological no-cut inputs (not from the paper, just robustness).
 static constexpr uint32_t kMaxStringLen = 1u << 15; // 32768 bytes
 
-static size_t next_cut_gear_msb5(const std::vector<uint8_t>& buf,
-                                size_t start, size_t end) {
+// The rolling hash is the shared Gear kernel (gear.h); it reports the byte
+// that hits, and the string ends after it.
+const GearParams ddelta_gear = {GEAR, kMaskMSB5, 1, 1, 0, kMaxStringLen};
+
+static size_t next_cut_gear_msb5(GearCutter& cutter, size_t start,
+                                 size_t end) {
   if (start >= end) return end;
 
-  uint32_t fp = 0;
-  size_t pos = start;
-  for (; pos < end; ++pos) {
-    fp = (fp << 1) + GEAR[buf[pos]];
-    size_t cur_len = (pos + 1) - start;
+  const size_t limit = std::min<size_t>(end, start + kMaxStringLen);
+  size_t hit = cutter.next_cut(start, end);
+  return hit < limit ? hit + 1 : limit;
+}
 
-    if (cur_len >= 1) {
-      if ((fp & kMaskMSB5) == kPattern) {
-        return pos + 1; // cut AFTER pos
-      }
-      if (cur_len >= kMaxStringLen) {
-        return pos + 1; // forced cut
-      }
-    }
-  }
-  return end;
+// Strings are only candidates, every hit is confirmed by memcmp, so a fast
+// non-cryptographic hash is enough here.
+static inline uint64_t string_fp(const uint8_t* p, size_t len) {
+  return XXH3_64bits(p, len);
+}
+
+// One pass per string: find its end and fingerprint it while it is hot.
+static inline size_t next_string(GearCutter& cutter, const uint8_t* buf,
+                                 size_t start, size_t end, uint64_t* fp) {
+  size_t cut = next_cut_gear_msb5(cutter, start, end);
+  *fp = string_fp(buf + start, cut - start);
+  return cut;
 }
 
 // ------------------------ Common prefix/suffix scan (chunk-level locality trick) ------------------------
 
-static size_t common_prefix(const std::vector<uint8_t>& a,
-                            const std::vector<uint8_t>& b) {
-  size_t n = std::min(a.size(), b.size());
-  size_t i = 0;
-  while (i < n && a[i] == b[i]) ++i;
-  return i;
+static size_t common_prefix(ByteView a, ByteView b) {
+  return match_forward(a.data, b.data, std::min(a.size, b.size));
 }
 
-static size_t common_suffix(const std::vector<uint8_t>& a,
-                            const std::vector<uint8_t>& b,
-                            size_t avoid_prefix) {
+static size_t common_suffix(ByteView a, ByteView b, size_t avoid_prefix) {
   // avoid overlapping the prefix region
-  size_t maxlen = std::min(a.size(), b.size());
-  size_t i = 0;
-  while (i < maxlen - avoid_prefix) {
-    size_t ai = a.size() - 1 - i;
-    size_t bi = b.size() - 1 - i;
-    if (a[ai] != b[bi]) break;
-    ++i;
-  }
-  return i;
+  size_t maxlen = std::min(a.size, b.size);
+  return match_backward(a.data + a.size, b.data + b.size, maxlen - avoid_prefix);
 }
 
 // ------------------------ Ddelta encode/decode ------------------------
 
-std::vector<uint8_t> DDeltaEncode(const std::vector<uint8_t>& src,
-                             const std::vector<uint8_t>& tgt) {
-  std::vector<Op> ops;
+size_t DDeltaEncode(ByteView src, ByteView tgt, uint8_t* out, size_t out_cap) {
+  std::vector<Op>& ops = op_list;
+  ops.clear();
 
   // 1) Chunk-level prefix/suffix matches (fast capture of big equal ends)
   size_t pre = common_prefix(src, tgt);
@@ -154,70 +221,65 @@ std::vector<uint8_t> DDeltaEncode(const std::vector<uint8_t>& src,
     op.type = Op::COPY;
     op.off = 0;
     op.len = static_cast<uint32_t>(pre);
-    merge_or_push(ops, std::move(op));
+    merge_or_push(ops, op);
   }
 
   // Define middle region to process with Ddelta string matching
   size_t t_mid_start = pre;
-  size_t t_mid_end = tgt.size() - suf;
+  size_t t_mid_end = tgt.size - suf;
 
-  // 2) Build base index: fingerprint -> list of offsets in src
+  // 2) Build base index: fingerprint -> offsets in src
   //    Strings are defined by GearChunking with MSB5 rule.
-  std::unordered_map<uint64_t, std::vector<uint32_t>> index;
-  index.reserve(src.size() / 16 + 1);
+  FlatIndex& index = base_index;
+  index.reset(src.size / 16 + 1);
 
+  GearCutter src_cutter(ddelta_gear, src.data);
   size_t s_last = 0;
-  while (s_last < src.size()) {
-    size_t s_cut = next_cut_gear_msb5(src, s_last, src.size());
-    size_t len = s_cut - s_last;
-    uint64_t fp = SpookyHash::Hash64(src.data() + s_last, len, 0);
-    index[fp].push_back(static_cast<uint32_t>(s_last));
+  while (s_last < src.size) {
+    uint64_t fp;
+    size_t s_cut = next_string(src_cutter, src.data, s_last, src.size, &fp);
+    index.insert(fp, static_cast<uint32_t>(s_last));
     s_last = s_cut;
   }
 
-  // 3) Process target middle by GearChunking + Spooky lookup + memcmp verify
+  // 3) Process target middle by GearChunking + hash lookup + memcmp verify
+  GearCutter tgt_cutter(ddelta_gear, tgt.data);
   size_t i = t_mid_start;
   while (i < t_mid_end) {
-    size_t cut = next_cut_gear_msb5(tgt, i, t_mid_end);
+    uint64_t fp;
+    size_t cut = next_string(tgt_cutter, tgt.data, i, t_mid_end, &fp);
     size_t str_len = cut - i;
 
-    uint64_t fp = SpookyHash::Hash64(tgt.data() + i, str_len, 0);
-
     bool matched = false;
     uint32_t best_off = 0;
     size_t best_len = 0;
 
-    auto it = index.find(fp);
-    if (it != index.end()) {
-      for (uint32_t off : it->second) {
-        if (static_cast<size_t>(off) + str_len <= src.size() &&
-            std::memcmp(src.data() + off, tgt.data() + i, str_len) == 0) {
-          matched = true;
-          best_off = off;
-          best_len = str_len;
-          break;
-        }
+    matched = index.find(fp, [&](uint32_t off) {
+      if (static_cast<size_t>(off) + str_len <= src.size &&
+          std::memcmp(src.data + off, tgt.data + i, str_len) == 0) {
+        best_off = off;
+        best_len = str_len;
+        return true;
       }
-    }
+      return false;
+    });
 
     if (!matched) {
       // INSERT this string
       Op op;
       op.type = Op::INSERT;
+      op.off = static_cast<uint32_t>(i);
       op.len = static_cast<uint32_t>(str_len);
-      op.data.insert(op.data.end(), tgt.begin() + i, tgt.begin() + cut);
-      merge_or_push(ops, std::move(op));
+      merge_or_push(ops, op);
       i = cut;
       continue;
     }
 
     // 4) String-level adjacent scanning:
     //    Extend forward across boundaries to capture nearby equal bytes.
-    while (i + best_len < t_mid_end &&
-           static_cast<size_t>(best_off) + best_len < src.size() &&
-           src[static_cast<size_t>(best_off) + best_len] == tgt[i + best_len]) {
-      ++best_len;
-    }
+    best_len += match_forward_padded(src.data + best_off + best_len, tgt.data + i + best_len,
+                                     std::min(t_mid_end - (i + best_len),
+                                              src.size - (best_off + best_len)));
 
     // Extend backward by stealing from the tail of a previous INSERT (if any).
     // This fixes "boundary drift" where a duplicated region got split by GearChunking.
@@ -228,16 +290,10 @@ std::vector<uint8_t> DDeltaEncode(const std::vector<uint8_t>& src,
 
       // How far can we go back without leaving the middle region or src bounds?
       size_t max_back = std::min({ins_len, static_cast<size_t>(best_off), i - t_mid_start});
-      while (back < max_back) {
-        uint8_t sb = src[static_cast<size_t>(best_off) - 1 - back];
-        uint8_t tb = tgt[i - 1 - back];
-        if (sb != tb) break;
-        ++back;
-      }
+      back = match_backward(src.data + best_off, tgt.data + i, max_back);
 
       if (back > 0) {
         // Remove bytes from the end of last INSERT
-        last.data.resize(last.data.size() - back);
         last.len -= static_cast<uint32_t>(back);
         if (last.len == 0) ops.pop_back();
 
@@ -252,7 +308,7 @@ std::vector<uint8_t> DDeltaEncode(const std::vector<uint8_t>& src,
     op.type = Op::COPY;
     op.off = best_off;
     op.len = static_cast<uint32_t>(best_len);
-    merge_or_push(ops, std::move(op));
+    merge_or_push(ops, op);
 
     i += best_len;
   }
@@ -261,38 +317,52 @@ std::vector<uint8_t> DDeltaEncode(const std::vector<uint8_t>& src,
   if (suf > 0) {
     Op op;
     op.type = Op::COPY;
-    op.off = static_cast<uint32_t>(src.size() - suf);
+    op.off = static_cast<uint32_t>(src.size - suf);
     op.len = static_cast<uint32_t>(suf);
-    merge_or_push(ops, std::move(op));
+    merge_or_push(ops, op);
   }
 
-  // 5) Serialize delta
-  std::vector<uint8_t> out;
-  out.reserve(tgt.size() / 2 + 32);
+  // 5) Serialize delta straight into the caller's buffer. Short COPYs cost
+  // more than the bytes they cover; if the records outgrow one INSERT of
+  // the whole target, that INSERT is the delta, which bounds every delta
+  // at tgt.size + DDELTA_MAX_OVERHEAD.
+  size_t need = 12;
+  for (const Op& op : ops) need += op.type == Op::COPY ? 9 : 5 + op.len;
+  if (need > tgt.size + DDELTA_MAX_OVERHEAD) {
+    ops.clear();
+    Op op;
+    op.type = Op::INSERT;
+    op.off = 0;
+    op.len = static_cast<uint32_t>(tgt.size);
+    merge_or_push(ops, op);
+    need = 12 + (tgt.size ? 5 + tgt.size : 0);
+  }
+  if (need > out_cap) throw std::runtime_error("delta larger than output buffer");
+  uint8_t* o = out;
 
   // Header
-  out.push_back('D'); out.push_back('D'); out.push_back('L'); out.push_back('T');
-  write_u32_le(out, 1u); // version
-  write_u32_le(out, static_cast<uint32_t>(tgt.size()));
+  *o++ = 'D'; *o++ = 'D'; *o++ = 'L'; *o++ = 'T';
+  o = put_u32_le(o, 1u); // version
+  o = put_u32_le(o, static_cast<uint32_t>(tgt.size));
 
   // Records
   for (const Op& op : ops) {
-    out.push_back(static_cast<uint8_t>(op.type));
-    write_u32_le(out, op.len);
+    *o++ = static_cast<uint8_t>(op.type);
+    o = put_u32_le(o, op.len);
     if (op.type == Op::COPY) {
-      write_u32_le(out, op.off);
+      o = put_u32_le(o, op.off);
     } else {
-      out.insert(out.end(), op.data.begin(), op.data.end());
+      std::memcpy(o, tgt.data + op.off, op.len);
+      o += op.len;
     }
   }
 
-  return out;
+  return static_cast<size_t>(o - out);
 }
 
-std::vector<uint8_t> DDeltaDecode(const std::vector<uint8_t>& src,
-                             const std::vector<uint8_t>& delta) {
-  const uint8_t* p = delta.data();
-  const uint8_t* end = delta.data() + delta.size();
+size_t DDeltaDecode(ByteView src, ByteView delta, uint8_t* out) {
+  const uint8_t* p = delta.data;
+  const uint8_t* end = delta.data + delta.size;
 
   if (end - p < 12) throw std::runtime_error("delta too small");
   if (!(p[0] == 'D' && p[1] == 'D' && p[2] == 'L' && p[3] == 'T')) {
@@ -304,34 +374,37 @@ std::vector<uint8_t> DDeltaDecode(const std::vector<uint8_t>& src,
   if (ver != 1u) throw std::runtime_error("unsupported version");
 
   uint32_t tgt_size = read_u32_le(p, end);
-  std::vector<uint8_t> out;
-  out.reserve(tgt_size);
+  size_t out_len = 0;
 
   while (p < end) {
     uint8_t type = read_u8(p, end);
     uint32_t len = read_u32_le(p, end);
 
+    if (len > tgt_size - out_len) {
+      throw std::runtime_error("record overruns target size");
+    }
     if (type == Op::COPY) {
       uint32_t off = read_u32_le(p, end);
-      if (static_cast<uint64_t>(off) + static_cast<uint64_t>(len) > src.size()) {
+      if (static_cast<uint64_t>(off) + static_cast<uint64_t>(len) > src.size) {
         throw std::runtime_error("COPY out of bounds");
       }
-      out.insert(out.end(), src.begin() + off, src.begin() + off + len);
+      std::memcpy(out + out_len, src.data + off, len);
     } else if (type == Op::INSERT) {
       if (static_cast<uint64_t>(end - p) < len) {
         throw std::runtime_error("INSERT truncated");
       }
-      out.insert(out.end(), p, p + len);
+      std::memcpy(out + out_len, p, len);
       p += len;
     } else {
       throw std::runtime_error("unknown record type");
     }
+    out_len += len;
   }
 
-  if (out.size() != tgt_size) {
+  if (out_len != tgt_size) {
     throw std::runtime_error("decoded size mismatch");
   }
-  return out;
+  return out_len;
 }
 
 } // namespace ddelta32
@@ -344,13 +417,10 @@ int DDeltaEncode(uint8_t* input, uint64_t input_size,
   }
 
   try {
-    std::vector<uint8_t> src(base, base + base_size);
-    std::vector<uint8_t> tgt(input, input + input_size);
-    std::vector<uint8_t> out = ddelta32::DDeltaEncode(src, tgt);
-
-    std::memcpy(delta, out.data(), out.size());
-    *delta_size = out.size();
-    return static_cast<int>(out.size());
+    size_t n = ddelta32::DDeltaEncode({base, base_size}, {input, input_size},
+                                      delta, *delta_size);
+    *delta_size = n;
+    return static_cast<int>(n);
   } catch (const std::exception&) {
     return -1;
   }
@@ -364,13 +434,10 @@ int DDeltaDecode(uint8_t* delta, uint64_t delta_size,
   }
 
   try {
-    std::vector<uint8_t> src(base, base + base_size);
-    std::vector<uint8_t> deltabuf(delta, delta + delta_size);
-    std::vector<uint8_t> out = ddelta32::DDeltaDecode(src, deltabuf);
-
-    std::memcpy(output, out.data(), out.size());
-    *output_size = out.size();
-    return static_cast<int>(out.size());
+    size_t n = ddelta32::DDeltaDecode({base, base_size}, {delta, delta_size},
+                                      output);
+    *output_size = n;
+    return static_cast<int>(n);
   } catch (const std::exception&) {
     return -1;
   }
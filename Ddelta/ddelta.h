@@ -4,7 +4,6 @@
 #include <cstdint>
 #include <cstring>
 #include <vector>
-#include <unordered_map>
 #include <algorithm>
 #include <stdexcept>
 #include <string>
@@ -13,6 +12,37 @@
 #include "util.h"
 #include "spooky.hpp"
 
+namespace ddelta32 {
+
+// Non-owning view of caller memory; the codec never copies its inputs.
+struct ByteView {
+  const uint8_t* data;
+  size_t size;
+};
+
+// A delta is never longer than the target plus its 12-byte header and one
+// 5-byte INSERT record header.
+#define DDELTA_MAX_OVERHEAD 17
+
+// Writes the delta of tgt against src to out and returns its size: a 12-byte
+// header plus 9 bytes per COPY and 5 per INSERT record plus the inserted
+// bytes, at most tgt.size + DDELTA_MAX_OVERHEAD. src and tgt stay readable
+// for MISMATCH_OVERREAD bytes past their ends (mismatch.h), as
+// DeltaEncoder's buffers do. Throws std::runtime_error on failure, among
+// them a delta larger than out_cap; out is then left unwritten.
+size_t DDeltaEncode(ByteView src, ByteView tgt, uint8_t* out, size_t out_cap);
+
+// Rebuilds the target into out, which must hold the target size recorded in
+// the delta header. Throws std::runtime_error on a malformed delta.
+size_t DDeltaDecode(ByteView src, ByteView delta, uint8_t* out);
+
+// String boundaries of DDeltaEncode
+extern const GearParams ddelta_gear;
+
+} // namespace ddelta32
+
+// *delta_size holds the room at delta on entry and the delta size on
+// return; -1 when the delta does not fit or encoding fails.
 int DDeltaEncode( uint8_t* input, uint64_t input_size,
 		  				uint8_t* base, uint64_t base_size,
 		  				uint8_t* delta, uint64_t *delta_size );	
@@ -1,11 +1,18 @@
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 #include "edelta.h"
+#include "edelta_varint.h"
+#include "ftable.h"
+#include "mismatch.h"
 #include "util.h"
 
+/* base string index, kept across calls so its arrays are allocated once */
+static thread_local ftable baseIndex;
+
 /* flag=0 for 'D', 1 for 'S' */
 void set_flag(void *record, uint32_t flag) {
   uint32_t *flag_length = (uint32_t *)record;
@@ -33,24 +40,116 @@ uint32_t get_length(void *record) {
   return (*flag_length) & ~(uint32_t)0 >> 1;
 }
 
-int Chunking_v3(unsigned char *data, int len, int num_of_chunks,
-                DeltaRecord *subChunkLink) {
-  int i = 0, *cut;
+static int deltaFormat = EDELTA_FORMAT_VARINT;
+
+void edelta_set_format(int format) { deltaFormat = format; }
+
+/* Record writer for both formats. A literal run is only written out when a
+ * copy or the end of the input closes it, so a copy that extends backwards
+ * just shortens the pending run.
+ */
+typedef struct {
+  uint8_t *buf;
+  uint32_t len;
+  int format;
+  uint32_t baseEnd;  /* end of the last copy, varint offsets are relative */
+  uint32_t litStart; /* pending literal run in the input */
+  uint32_t litLen;
+} DeltaWriter;
+
+static inline void write_varint(DeltaWriter *w, uint64_t v) {
+  w->len += put_varint(w->buf + w->len, v);
+}
+
+static inline void write_field(DeltaWriter *w, uint32_t v, uint32_t bytes) {
+  put_field(w->buf + w->len, v, bytes);
+  w->len += bytes;
+}
+
+static void writer_init(DeltaWriter *w, uint8_t *deltaBuf, uint64_t newSize) {
+  w->buf = deltaBuf;
+  w->len = 0;
+  w->format = deltaFormat;
+  w->baseEnd = 0;
+  w->litStart = 0;
+  w->litLen = 0;
+  if (w->format == EDELTA_FORMAT_VARINT) {
+    memcpy(w->buf, EDELTA_VARINT_MAGIC, sizeof(EDELTA_VARINT_MAGIC));
+    w->len = sizeof(EDELTA_VARINT_MAGIC);
+    w->buf[w->len++] = EDELTA_FORMAT_VARINT;
+    write_varint(w, newSize);
+  }
+}
+
+static inline void add_literal(DeltaWriter *w, uint32_t pos, uint32_t length) {
+  if (w->litLen == 0)
+    w->litStart = pos;
+  w->litLen += length;
+}
+
+static void flush_literal(DeltaWriter *w, const uint8_t *newBuf) {
+  if (w->litLen == 0)
+    return;
+  if (w->format == EDELTA_FORMAT_VARINT) {
+    uint32_t lb = field_bytes(w->litLen);
+    w->buf[w->len++] = EDELTA_LITERAL | (lb - 1) << 1;
+    write_field(w, w->litLen, lb);
+  } else {
+    DeltaUnit2 record2;
+    set_flag(&record2, 1);
+    set_length(&record2, w->litLen);
+    memcpy(w->buf + w->len, &record2, sizeof(DeltaUnit2));
+    w->len += sizeof(DeltaUnit2);
+  }
+  memcpy(w->buf + w->len, newBuf + w->litStart, w->litLen);
+  w->len += w->litLen;
+  w->litLen = 0;
+}
+
+static void emit_copy(DeltaWriter *w, const uint8_t *newBuf, uint32_t offset,
+                      uint32_t length) {
+  flush_literal(w, newBuf);
+  if (w->format == EDELTA_FORMAT_VARINT) {
+    /* zigzag, so short backward jumps stay one byte too */
+    int32_t rel = (int32_t)(offset - w->baseEnd);
+    uint32_t zz = ((uint32_t)rel << 1) ^ (uint32_t)(rel >> 31);
+    uint32_t lb = field_bytes(length), rb = field_bytes(zz);
+    w->buf[w->len++] = (lb - 1) << 1 | (rb - 1) << 3;
+    write_field(w, length, lb);
+    write_field(w, zz, rb);
+    w->baseEnd = offset + length;
+  } else {
+    DeltaUnit1 record1;
+    set_flag(&record1, 0);
+    set_length(&record1, length);
+    record1.nOffset = offset;
+    memcpy(w->buf + w->len, &record1, sizeof(DeltaUnit1));
+    w->len += sizeof(DeltaUnit1);
+  }
+}
+
+/* @cut and @hash are caller scratch for num_of_chunks + 1 cut points and
+ * num_of_chunks hashes, so chunking never touches the allocator.
+ */
+int Chunking_v3(GearCutter &cutter, unsigned char *buf, int pos, int len,
+                int num_of_chunks, DeltaRecord *subChunkLink, int *cut,
+                uint64_t *hash) {
+  int i = 0;
+  unsigned char *data = buf + pos;
   /* cut is the chunking points in the stream */
-  cut = (int *)malloc((num_of_chunks + 1) * sizeof(int));
-  int numBytes =
-      rolling_gear_v3(data, len, num_of_chunks, cut); //分割给定快的总字节数
+  int numBytes = rolling_gear_v3(cutter, pos, len, num_of_chunks,
+                                 cut); //分割给定快的总字节数
+  weakHashBatch(data, cut, num_of_chunks, hash);
 
   while (i < num_of_chunks) {
     int chunkLen = cut[i + 1] - cut[i];
     subChunkLink[i].nLength = chunkLen;
     subChunkLink[i].nOffset = cut[i]; /**/
     subChunkLink[i].DupFlag = 0;
-    subChunkLink[i].nHash = weakHash(data + cut[i], chunkLen);
+    subChunkLink[i].nHash = hash[i];
     //	SpookyHash::Hash64(data+ cut[i], chunkLen, 0x1af1);
     i++;
   }
-  free(cut);
   return numBytes;
 }
 
@@ -60,37 +159,15 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
   uint32_t beg = 0, end = 0, begSize = 0, endSize = 0;
   float matchsum = 0;
   float match = 0;
-  while (begSize + 7 < baseSize && begSize + 7 < newSize) {
-    if (*(uint64_t *)(baseBuf + begSize) == *(uint64_t *)(newBuf + begSize)) {
-      begSize += 8;
-    } else
-      break;
-  }
-  while (begSize < baseSize && begSize < newSize) {
-    if (baseBuf[begSize] == newBuf[begSize]) {
-      begSize++;
-    } else
-      break;
-  }
+  begSize = match_forward(baseBuf, newBuf, std::min(baseSize, newSize));
 
   if (begSize > 16)
     beg = 1;
   else
     begSize = 0;
 
-  while (endSize + 7 < baseSize && endSize + 7 < newSize) {
-    if (*(uint64_t *)(baseBuf + baseSize - endSize - 8) ==
-        *(uint64_t *)(newBuf + newSize - endSize - 8)) {
-      endSize += 8;
-    } else
-      break;
-  }
-  while (endSize < baseSize && endSize < newSize) {
-    if (baseBuf[baseSize - endSize - 1] == newBuf[newSize - endSize - 1]) {
-      endSize++;
-    } else
-      break;
-  }
+  endSize = match_backward(baseBuf + baseSize, newBuf + newSize,
+                           std::min(baseSize, newSize));
 
   if (begSize + endSize > newSize)
     endSize = newSize - begSize;
@@ -101,38 +178,23 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
     endSize = 0;
   /* end of detect */
 
-  if (begSize + endSize >= baseSize) {
-    DeltaUnit1 record1;
-    DeltaUnit2 record2;
-    uint32_t deltaLen = 0;
-    if (beg) {
-      set_flag(&record1, 0);
-      record1.nOffset = 0;
-      set_length(&record1, begSize);
-      memcpy(deltaBuf + deltaLen, &record1, sizeof(DeltaUnit1));
-      deltaLen += sizeof(DeltaUnit1);
-    }
-    if (newSize - begSize - endSize > 0) {
-      set_flag(&record2, 1);
-      set_length(&record2, newSize - begSize - endSize);
-      memcpy(deltaBuf + deltaLen, &record2, sizeof(DeltaUnit2));
-      deltaLen += sizeof(DeltaUnit2);
-      memcpy(deltaBuf + deltaLen, newBuf + begSize, get_length(&record2));
-      deltaLen += get_length(&record2);
-    }
-    if (end) {
-      set_flag(&record1, 0);
-      record1.nOffset = baseSize - endSize;
-      set_length(&record1, endSize);
-      memcpy(deltaBuf + deltaLen, &record1, sizeof(DeltaUnit1));
-      deltaLen += sizeof(DeltaUnit1);
-    }
+  DeltaWriter writer;
+  writer_init(&writer, deltaBuf, newSize);
 
-    *deltaSize = deltaLen;
-    return deltaLen;
+  if (begSize + endSize >= baseSize) {
+    if (beg)
+      emit_copy(&writer, newBuf, 0, begSize);
+    if (newSize - begSize - endSize > 0)
+      add_literal(&writer, begSize, newSize - begSize - endSize);
+    if (end)
+      emit_copy(&writer, newBuf, baseSize - endSize, endSize);
+    else
+      flush_literal(&writer, newBuf);
+
+    *deltaSize = writer.len;
+    return writer.len;
   }
 
-  uint32_t deltaLen = 0;
   uint32_t cursor_base = begSize;
   uint32_t cursor_input = begSize;
   uint32_t cursor_input1 = 0;
@@ -141,27 +203,10 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
   uint32_t inputPos = begSize;
   uint32_t length;
   uint64_t hash;
-  DeltaRecord *psDupSubCnk = NULL;
-  DeltaUnit1 record1;
-  DeltaUnit2 record2;
-  set_flag(&record1, 0);
-  set_flag(&record2, 1);
-  int flag = 0; /* to represent the last record in the deltaBuf,
-       1 for DeltaUnit1, 2 for DeltaUnit2 */
-
-  int numBase = 0;  /* the total number of chunks that the base has chunked */
+  uint32_t dupOffset = 0, dupLength = 0; /* base string matching the input */
+
   int numBytes = 0; /* the number of bytes that the base chunks once */
-  DeltaRecord *BaseLink = (DeltaRecord *)malloc(
-      sizeof(DeltaRecord) * ((baseSize - begSize - endSize) / STRMIN + 50));
-
-  int offset = (char *)&BaseLink[0].psNextSubCnk - (char *)&BaseLink[0];
-  htable *psHTable = (htable *)malloc(sizeof(htable));
-  // psHTable->init(offset, 8, baseSize/16);
-#if POST_DEDUP
-  psHTable->init(offset, 8, (baseSize - begSize - endSize) * 2 / (STRAVG + 1));
-#else
-  psHTable->init(offset, 8, 8 * 1024);
-#endif
+  baseIndex.reset((baseSize - begSize - endSize) / STRMIN + 50);
 
   // int chunk_length;
   int flag_chunk = 1; // to tell if basefile has been chunked to the end
@@ -171,13 +216,8 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
   int probe_match; // to tell which chunk for probing matches the some base
   int flag_handle_probe; // to tell whether the probe chunks need to be handled
 
-  if (beg) {
-    record1.nOffset = 0;
-    set_length(&record1, begSize);
-    memcpy(deltaBuf + deltaLen, &record1, sizeof(DeltaUnit1));
-    deltaLen += sizeof(DeltaUnit1);
-    flag = 1;
-  }
+  if (beg)
+    emit_copy(&writer, newBuf, 0, begSize);
 
 #define BASE_BEGIN 5
 #define BASE_EXPAND 3
@@ -191,7 +231,21 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
 
 #define RECOMPRESS_THRESHOLD 0.2
 
+  /* chunk_number of the last BASE_STEP round */
+  constexpr int maxBaseChunks = [] {
+    int n = BASE_BEGIN;
+    for (int i = 1; i < BASE_STEP; i++)
+      n *= BASE_EXPAND;
+    return n;
+  }();
+  DeltaRecord BaseLink[maxBaseChunks];
+  int baseCut[maxBaseChunks + 1];
+  uint64_t baseHash[maxBaseChunks];
+
   DeltaRecord InputLink[INPUT_TRY];
+
+  GearCutter baseCutter(edelta_gear, baseBuf);
+  GearCutter inputCutter(edelta_gear, newBuf);
   // int test=0;
 
   while (inputPos < newSize - endSize) {
@@ -211,22 +265,21 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
         int chunk_number = BASE_BEGIN;
         for (int i = 0; i < BASE_STEP; i++) {
           numBytes = Chunking_v3(
-              baseBuf + cursor_base, baseSize - endSize - cursor_base,
-              chunk_number,
-              BaseLink + numBase); //一个分块base的循环找到 match的就可以跳出
+              baseCutter, baseBuf, cursor_base,
+              baseSize - endSize - cursor_base, chunk_number, BaseLink,
+              baseCut, baseHash); //一个分块base的循环找到 match的就可以跳出
 
           for (int j = 0; j < chunk_number; j++) {
-            if (BaseLink[numBase + j].nLength == 0) {
+            if (BaseLink[j].nLength == 0) {
               flag_chunk = 0;
               break;
             }
-            BaseLink[numBase + j].nOffset += cursor_base;
-            psHTable->insert((unsigned char *)&BaseLink[numBase + j].nHash,
-                             &BaseLink[numBase + j]);
+            BaseLink[j].nOffset += cursor_base;
+            baseIndex.insert(BaseLink[j].nHash, BaseLink[j].nOffset,
+                             BaseLink[j].nLength);
           }
 
           cursor_base += numBytes;
-          numBase += chunk_number;
           numBytes_accu += numBytes;
 
           chunk_number *= BASE_EXPAND;
@@ -234,22 +287,21 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
             cursor_input1 = cursor_input;
             for (int j = 0; j < INPUT_TRY; j++) {
               cursor_input2 = cursor_input1;
-              cursor_input1 = chunk_gear(newBuf + cursor_input2,
-                                         newSize - cursor_input2 - endSize) +
-                              cursor_input2;
+              cursor_input1 = chunk_gear(inputCutter, cursor_input2,
+                                         newSize - endSize);
               InputLink[j].nLength = cursor_input1 - cursor_input2;
               InputLink[j].nHash =
                   weakHash(newBuf + cursor_input2, InputLink[j].nLength);
-              if ((psDupSubCnk = (DeltaRecord *)psHTable->lookup(
-                       (unsigned char *)&(InputLink[j].nHash)))) {
+              if (baseIndex.lookup(InputLink[j].nHash, &dupOffset,
+                                   &dupLength)) {
                 probe_match = j;
                 goto lets_break;
               }
             }
           } else {
             for (int j = 0; j < INPUT_TRY; j++) {
-              if ((psDupSubCnk = (DeltaRecord *)psHTable->lookup(
-                       (unsigned char *)&(InputLink[j].nHash)))) {
+              if (baseIndex.lookup(InputLink[j].nHash, &dupOffset,
+                                   &dupLength)) {
                 //printf("find INPUT_TRY: %d BASE_STEP: %d" 
 								//	" cursor_input: %d round of chunk: %d\n",
                 //	j,i,cursor_input,test);
@@ -283,26 +335,7 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
           flag_handle_probe = 0;
           goto match;
         } else {
-          if (flag == 2) { //把不match的块弄过去
-            /* continuous unique chunks only add unique bytes into the deltaBuf,
-             * but not change the last DeltaUnit2, so the DeltaUnit2 should be
-             * overwritten when flag=1 or at the end of the loop.
-             */
-            memcpy(deltaBuf + deltaLen, newBuf + inputPos, length);
-            deltaLen += length;
-            set_length(&record2, get_length(&record2) + length);
-          } else {
-            set_length(&record2, length);
-
-            memcpy(deltaBuf + deltaLen, &record2, sizeof(DeltaUnit2));
-            deltaLen += sizeof(DeltaUnit2);
-
-            memcpy(deltaBuf + deltaLen, newBuf + inputPos, length);
-            deltaLen += length;
-
-            flag = 2;
-          }
-
+          add_literal(&writer, inputPos, length); //把不match的块弄过去
           inputPos = cursor_input;
         }
       }
@@ -310,90 +343,48 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
       flag_handle_probe = 0;
     }
 
-    cursor_input =
-        chunk_gear(newBuf + inputPos, newSize - inputPos - endSize) + inputPos;
+    cursor_input = chunk_gear(inputCutter, inputPos, newSize - endSize);
     matchsum++;
     length = cursor_input - inputPos;
     hash = weakHash(newBuf + inputPos, length);
 
     /* lookup */
-    if ((psDupSubCnk =
-             (DeltaRecord *)psHTable->lookup((unsigned char *)&hash))) {
+    if (baseIndex.lookup(hash, &dupOffset, &dupLength)) {
     // printf("inputPos: %d length: %d\n", inputPos, length);
     match:
-      if (length == psDupSubCnk->nLength &&
-          memcmp(newBuf + inputPos, baseBuf + psDupSubCnk->nOffset, length) ==
+      if (length == dupLength &&
+          memcmp(newBuf + inputPos, baseBuf + dupOffset, length) ==
               0) {
         //	printf("match:%d\n",length);
         match++;
-        if (flag == 2) {
-          /* continuous unique chunks only add unique bytes into the deltaBuf,
-           * but not change the last DeltaUnit2, so the DeltaUnit2 should be
-           * overwritten when flag=1 or at the end of the loop.
-           */
-          memcpy(deltaBuf + deltaLen - get_length(&record2) -
-                     sizeof(DeltaUnit2),
-                 &record2, sizeof(DeltaUnit2));
-        }
 
         // greedily detect forward
         int j = 0;
-
-        while (psDupSubCnk->nOffset + length + j + 7 < baseSize - endSize &&
-               cursor_input + j + 7 < newSize - endSize) {
-          if (*(uint64_t *)(baseBuf + psDupSubCnk->nOffset + length + j) ==
-              *(uint64_t *)(newBuf + cursor_input + j)) {
-            j += 8;
-          } else
-            break;
-        }
-        while (psDupSubCnk->nOffset + length + j < baseSize - endSize &&
-               cursor_input + j < newSize - endSize) {
-          if (baseBuf[psDupSubCnk->nOffset + length + j] ==
-              newBuf[cursor_input + j]) {
-            j++;
-          } else
-            break;
+        if (dupOffset + length < baseSize - endSize &&
+            cursor_input < newSize - endSize) {
+          j = match_forward_padded(baseBuf + dupOffset + length,
+                                   newBuf + cursor_input,
+                                   std::min(baseSize - endSize - dupOffset - length,
+                                            newSize - endSize - cursor_input));
         }
 
         cursor_input += j;
-        if (psDupSubCnk->nOffset + length + j > cursor_base)
-          cursor_base = psDupSubCnk->nOffset + length + j;
-
-        set_length(&record1, cursor_input - inputPos);
-        record1.nOffset = psDupSubCnk->nOffset;
-
-        /* detect backward */
-        uint32_t k = 0;
-        if (flag == 2) {
-          while (k + 1 <= psDupSubCnk->nOffset &&
-                 k + 1 <= get_length(&record2)) {
-            if (baseBuf[psDupSubCnk->nOffset - (k + 1)] ==
-                newBuf[inputPos - (k + 1)])
-              k++;
-            else
-              break;
-          }
-        }
-        if (k > 0) {
-          deltaLen -= get_length(&record2);
-          deltaLen -= sizeof(DeltaUnit2);
+        if (dupOffset + length + j > cursor_base)
+          cursor_base = dupOffset + length + j;
 
-          set_length(&record2, get_length(&record2) - k);
-
-          if (get_length(&record2) > 0) {
-            memcpy(deltaBuf + deltaLen, &record2, sizeof(DeltaUnit2));
-            deltaLen += sizeof(DeltaUnit2);
-            deltaLen += get_length(&record2);
-          }
+        uint32_t copyOffset = dupOffset;
+        uint32_t copyLength = cursor_input - inputPos;
 
-          set_length(&record1, get_length(&record1) + k);
-          record1.nOffset -= k;
+        /* detect backward into the pending literal run */
+        uint32_t k = match_backward(baseBuf + dupOffset, newBuf + inputPos,
+                                    std::min(dupOffset, writer.litLen));
+        if (k > 0) {
+          writer.litLen -= k;
+          copyLength += k;
+          copyOffset -= k;
         }
 
-        memcpy(deltaBuf + deltaLen, &record1, sizeof(DeltaUnit1));
-        deltaLen += sizeof(DeltaUnit1);
-        flag = 1;
+        emit_copy(&writer, newBuf, copyOffset, copyLength);
       } else {
         printf("Spooky Hash Error!!!!!!!!!!!!!!!!!!\n");
         goto handle_hash_error;
@@ -401,60 +392,103 @@ int EDeltaEncode(uint8_t *newBuf, uint64_t newSize, uint8_t *baseBuf,
     } else {
     handle_hash_error:
       //	printf("unmatch:%d\n",length);
-      if (flag == 2) {
-        /* continuous unique chunks only add unique bytes into the deltaBuf,
-         * but not change the last DeltaUnit2, so the DeltaUnit2 should be
-         * overwritten when flag=1 or at the end of the loop.
-         */
-        memcpy(deltaBuf + deltaLen, newBuf + inputPos, length);
-        deltaLen += length;
-        set_length(&record2, get_length(&record2) + length);
-      } else {
-        set_length(&record2, length);
-
-        memcpy(deltaBuf + deltaLen, &record2, sizeof(DeltaUnit2));
-        deltaLen += sizeof(DeltaUnit2);
-
-        memcpy(deltaBuf + deltaLen, newBuf + inputPos, length);
-        deltaLen += length;
-
-        flag = 2;
-      }
+      add_literal(&writer, inputPos, length);
     }
 
     inputPos = cursor_input;
     // printf("cursor_input:%d\n",inputPos);
   }
 
-  if (flag == 2) {
-    /* continuous unique chunks only add unique bytes into the deltaBuf,
-     * but not change the last DeltaUnit2, so the DeltaUnit2 should be
-     * overwritten when flag=1 or at the end of the loop.
-     */
-    memcpy(deltaBuf + deltaLen - get_length(&record2) - sizeof(DeltaUnit2),
-           &record2, sizeof(DeltaUnit2));
-  }
+  flush_literal(&writer, newBuf);
+  if (end)
+    emit_copy(&writer, newBuf, baseSize - endSize, endSize);
 
-  if (end) {
-    record1.nOffset = baseSize - endSize;
-    set_length(&record1, endSize);
-    memcpy(deltaBuf + deltaLen, &record1, sizeof(DeltaUnit1));
-    deltaLen += sizeof(DeltaUnit1);
-  }
-
-  if (psHTable) {
-    free(psHTable->table);
-    free(psHTable);
-  }
+  *deltaSize = writer.len;
+  return writer.len;
+}
 
-  free(BaseLink);
+static int EDeltaDecodeVarint(uint8_t *deltaBuf, uint64_t deltaSize,
+                              uint8_t *baseBuf, uint64_t baseSize,
+                              uint8_t *outBuf, uint64_t *outSize) {
+  const uint8_t *p = deltaBuf + sizeof(EDELTA_VARINT_MAGIC) + 1;
+  const uint8_t *end = deltaBuf + deltaSize;
+  uint64_t targetSize = get_varint(&p, end);
+  uint8_t *out = outBuf;
+  uint8_t *outEnd = outBuf + targetSize;
+  uint32_t basePos = 0;
+
+  while (p < end) {
+    uint32_t ctrl = *p;
+    uint32_t lb = ((ctrl >> 1) & 3) + 1;
+    uint32_t rb = ((ctrl >> 3) & 3) + 1;
+    uint32_t len, rel;
+    if (end - p > 8) {
+      /* both fields come out of one load, the header size out of ctrl */
+      uint64_t x;
+      memcpy(&x, p + 1, sizeof(x));
+      len = (uint32_t)x & (uint32_t)(((uint64_t)1 << (8 * lb)) - 1);
+      rel = (uint32_t)(x >> (8 * lb)) &
+            (uint32_t)(((uint64_t)1 << (8 * rb)) - 1);
+    } else {
+      if ((uint64_t)(end - p) < 1 + lb + (ctrl & EDELTA_LITERAL ? 0 : rb))
+        goto corrupt;
+      len = get_field(p + 1, lb);
+      rel = get_field(p + 1 + lb, rb);
+    }
+    if (len > (uint64_t)(outEnd - out))
+      goto corrupt;
+
+    const uint8_t *src;
+    size_t srcRoom;
+    if (ctrl & EDELTA_LITERAL) {
+      src = p + 1 + lb;
+      srcRoom = end - src;
+      if (len > srcRoom)
+        goto corrupt;
+      p = src + len;
+    } else {
+      basePos += (rel >> 1) ^ (0 - (rel & 1));
+      if (basePos > baseSize || len > baseSize - basePos)
+        goto corrupt;
+      src = baseBuf + basePos;
+      srcRoom = baseSize - basePos;
+      basePos += len;
+      p += 1 + lb + rb;
+    }
 
-  *deltaSize = deltaLen;
-  return deltaLen;
+    /* records average STRAVG bytes: round short ones up to one 32-byte
+     * move when both sides have the slack */
+    if (len <= 32 && srcRoom >= 32 && outEnd - out >= 32) {
+      memcpy(out, src, 16);
+      memcpy(out + 16, src + 16, 16);
+    } else {
+      memcpy(out, src, len);
+    }
+    out += len;
+  }
+  /* records that end short of the header's size: a truncated delta */
+  if (out != outEnd)
+    goto corrupt;
+  *outSize = out - outBuf;
+  return *outSize;
+
+corrupt:
+  *outSize = 0;
+  return -1;
 }
 
+/* legacy deltas have no header, their first record always has a length */
 int EDeltaDecode(uint8_t *deltaBuf, uint64_t deltaSize, uint8_t *baseBuf,
                  uint64_t baseSize, uint8_t *outBuf, uint64_t *outSize) {
+  if (deltaSize > sizeof(EDELTA_VARINT_MAGIC) &&
+      memcmp(deltaBuf, EDELTA_VARINT_MAGIC, sizeof(EDELTA_VARINT_MAGIC)) == 0) {
+    if (deltaBuf[sizeof(EDELTA_VARINT_MAGIC)] != EDELTA_FORMAT_VARINT) {
+      *outSize = 0;
+      return -1;
+    }
+    return EDeltaDecodeVarint(deltaBuf, deltaSize, baseBuf, baseSize, outBuf,
+                              outSize);
+  }
 
   uint32_t dataLength = 0, readLength = 0;
   int matchnum = 0;
@@ -6,7 +6,36 @@
 #include "htable.h"
 #include "util.h"
 
+/*
+ * Delta formats.
+ * LEGACY: fixed records, DeltaUnit1 (8 bytes) per copy and DeltaUnit2
+ *   (4 bytes) before each literal run, no header.
+ * VARINT: "\0\0\0\x80", a version byte and the LEB128 target size, then
+ *   records made of a control byte and little-endian fields of 1..4 bytes:
+ *     bit 0     EDELTA_LITERAL, else copy
+ *     bits 1-2  length field bytes - 1
+ *     bits 3-4  offset field bytes - 1 (copies only)
+ *   A literal's bytes follow its length. A copy's offset is the zigzag
+ *   distance from the end of the previous copy in the base, which is
+ *   usually small since matches come in base order. The control byte gives
+ *   the record size up front, so the decoder never walks a varint byte by
+ *   byte. The magic is a legacy DeltaUnit2 of length 0, which the legacy
+ *   encoder never writes.
+ * EDeltaDecode reads both; EDeltaEncode writes the one set last.
+ */
+#define EDELTA_FORMAT_LEGACY 0
+#define EDELTA_FORMAT_VARINT 1
+
+#define EDELTA_LITERAL 1
+
+static const uint8_t EDELTA_VARINT_MAGIC[4] = {0, 0, 0, 0x80};
+
+/* format written by EDeltaEncode, default EDELTA_FORMAT_VARINT */
+void edelta_set_format(int format);
+
 // Attention! input should not be empty! base should not be empty!
+// Both stay readable for MISMATCH_OVERREAD bytes past their ends
+// (mismatch.h), as DeltaEncoder's buffers do.
 int EDeltaEncode( uint8_t* input, uint64_t input_size,
 		  				uint8_t* base, uint64_t base_size,
 		  				uint8_t* delta, uint64_t *delta_size );	
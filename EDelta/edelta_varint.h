@@ -0,0 +1,48 @@
+#pragma once
+/* Integer coding of the VARINT format (edelta.h), shared by the encoder's
+ * writer, the decoder and delta_microbench.
+ */
+#include <cstdint>
+
+/* LEB128; returns the bytes written */
+static inline uint32_t put_varint(uint8_t *p, uint64_t v) {
+  uint32_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+static inline uint64_t get_varint(const uint8_t **pp, const uint8_t *end) {
+  const uint8_t *p = *pp;
+  uint64_t v = 0;
+  int shift = 0;
+  while (p < end && *p >= 0x80 && shift < 63) {
+    v |= (uint64_t)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  if (p < end)
+    v |= (uint64_t)*p++ << shift;
+  *pp = p;
+  return v;
+}
+
+/* bytes needed for @v in a record field, 1..4 */
+static inline uint32_t field_bytes(uint32_t v) {
+  return v < (1u << 8) ? 1 : v < (1u << 16) ? 2 : v < (1u << 24) ? 3 : 4;
+}
+
+/* little-endian, the low @bytes bytes of @v */
+static inline void put_field(uint8_t *p, uint32_t v, uint32_t bytes) {
+  for (uint32_t i = 0; i < bytes; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t get_field(const uint8_t *p, uint32_t bytes) {
+  uint32_t v = 0;
+  for (uint32_t i = 0; i < bytes; i++)
+    v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
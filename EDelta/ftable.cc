@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "ftable.h"
+
+#define FTABLE_MIN_BUCKETS 64
+
+ftable::ftable()
+{
+   keys = NULL;
+   offsets = NULL;
+   lengths = NULL;
+   buckets = 0;
+   mask = 0;
+   num_items = 0;
+   max_items = 0;
+   capacity = 0;
+}
+
+ftable::~ftable()
+{
+   free(keys);
+   free(offsets);
+   free(lengths);
+}
+
+void ftable::allocate(uint32_t nbuckets)
+{
+   keys = (uint64_t *)malloc(nbuckets * sizeof(uint64_t));
+   offsets = (uint32_t *)malloc(nbuckets * sizeof(uint32_t));
+   lengths = (uint32_t *)malloc(nbuckets * sizeof(uint32_t));
+   capacity = nbuckets;
+}
+
+/* @nitems: expected number of items, the table stays at most half full */
+void ftable::reset(uint32_t nitems)
+{
+   uint32_t nbuckets = FTABLE_MIN_BUCKETS;
+   while (nbuckets < nitems * 2) {
+      nbuckets <<= 1;
+   }
+   if (nbuckets > capacity) {
+      free(keys);
+      free(offsets);
+      free(lengths);
+      allocate(nbuckets);
+   }
+   buckets = nbuckets;
+   mask = nbuckets - 1;
+   num_items = 0;
+   max_items = nbuckets / 2;
+   memset(keys, 0, buckets * sizeof(uint64_t));
+}
+
+void ftable::grow_table()
+{
+   uint64_t *old_keys = keys;
+   uint32_t *old_offsets = offsets;
+   uint32_t *old_lengths = lengths;
+   uint32_t old_buckets = buckets;
+
+   allocate(buckets * 2);
+   buckets *= 2;
+   mask = buckets - 1;
+   max_items = buckets / 2;
+   memset(keys, 0, buckets * sizeof(uint64_t));
+
+   for (uint32_t j = 0; j < old_buckets; j++) {
+      if (!old_keys[j])
+         continue;
+      uint32_t i = old_keys[j] & mask;
+      while (keys[i])
+         i = (i + 1) & mask;
+      keys[i] = old_keys[j];
+      offsets[i] = old_offsets[j];
+      lengths[i] = old_lengths[j];
+   }
+
+   free(old_keys);
+   free(old_offsets);
+   free(old_lengths);
+}
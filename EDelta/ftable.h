@@ -0,0 +1,72 @@
+#pragma once
+/* ========================================================================
+ *
+ *   Flat hash table class -- ftable
+ *
+ */
+
+#include <cstdint>
+
+/*
+ * Open-addressing replacement for htable on the base string index.
+ * Keys are the 64-bit weakHash of a base string; the string's offset and
+ * length live in parallel arrays next to the key, so a probe touches one
+ * or two cache lines and never follows a pointer. Inserting an existing key
+ * overwrites it, which matches htable::lookup returning the newest item of
+ * a chain.
+ *
+ * The arrays only grow, so one table can be reset() and reused for every
+ * chunk instead of being rebuilt from malloc each time.
+ */
+class ftable {
+public:
+   uint64_t *keys;                    /* weakHash, 0 = empty slot */
+   uint32_t *offsets;                 /* string offset in the base */
+   uint32_t *lengths;                 /* string length */
+   uint32_t buckets;                  /* slots in use, power of two */
+   uint32_t mask;                     /* buckets - 1 */
+   uint32_t num_items;                /* current number of items */
+   uint32_t max_items;                /* maximum items before growing */
+   uint32_t capacity;                 /* slots allocated */
+
+   ftable();
+   ~ftable();
+   void reset(uint32_t nitems);       /* empty the table, room for nitems */
+
+   /* 0 marks an empty slot, fold it onto another key */
+   static uint64_t slot_key(uint64_t key) { return key ? key : 1; }
+
+   void insert(uint64_t key, uint32_t offset, uint32_t length) {
+      key = slot_key(key);
+      uint32_t i = key & mask;
+      while (keys[i] && keys[i] != key)
+         i = (i + 1) & mask;
+      if (!keys[i]) {
+         keys[i] = key;
+         if (++num_items >= max_items) {
+            offsets[i] = offset;
+            lengths[i] = length;
+            grow_table();
+            return;
+         }
+      }
+      offsets[i] = offset;
+      lengths[i] = length;
+   }
+
+   bool lookup(uint64_t key, uint32_t *offset, uint32_t *length) const {
+      key = slot_key(key);
+      for (uint32_t i = key & mask; keys[i]; i = (i + 1) & mask) {
+         if (keys[i] == key) {
+            *offset = offsets[i];
+            *length = lengths[i];
+            return true;
+         }
+      }
+      return false;
+   }
+
+private:
+   void allocate(uint32_t nbuckets);
+   void grow_table();                 /* double buckets and rehash */
+};
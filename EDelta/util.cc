@@ -6,71 +6,48 @@
 #include "xxhash.h"
 
 uint64_t weakHash(unsigned char *buf, int len) {
-  return XXH64(buf, len, 0x7fcaf1);
+  return XXH3_64bits_withSeed(buf, len, 0x7fcaf1);
+}
+
+void weakHashBatch(unsigned char *data, const int *cut, int num_of_chunks,
+                   uint64_t *hash) {
+  /* independent hashes, so consecutive strings overlap in the pipeline */
+  for (int i = 0; i < num_of_chunks; i++) {
+    hash[i] = XXH3_64bits_withSeed(data + cut[i], cut[i + 1] - cut[i],
+                                   0x7fcaf1);
+  }
 }
 
 // jump by STRMIN bytes
 /* different from rolling_gear_v2, where @n indicates the bytes left in @p that
  * can be chunked. And rolling_gear_v2 is abandoned.
+ * @pos is where @p starts in the buffer of @cutter; @cut is relative to @p.
  */
-int rolling_gear_v3(unsigned char *p, int n, int num_of_chunks, int *cut) {
-  uint32_t fingerprint = 0;
-  int i = 0, count = 0;
+int rolling_gear_v3(GearCutter &cutter, int pos, int n, int num_of_chunks,
+                    int *cut) {
+  int count = 0;
   cut[count++] = 0;
 
-  i += STRMIN + 1;
-
-  int j = 0;
-  while (j < num_of_chunks) {
-    if (i < n) {
-      fingerprint = (fingerprint << 1) + GEAR[p[i]];
-      if (i <= (cut[count - 1] + STRMAX)) {
-        if (!(fingerprint & STRAVG)) {
-          /* this requires the last few bits of fingerprint to be all 0 */
-          cut[count++] = i;
-          i += STRMIN;
-          fingerprint = 0;
-          j++;
-        }
-      } else {
-        cut[count++] = i;
-        i += STRMIN;
-        fingerprint = 0;
-        j++;
-      }
-      i++;
-    } else {
-      while (j < num_of_chunks) {
+  while (count <= num_of_chunks) {
+    int last = cut[count - 1];
+    if (last + STRMIN + 1 >= n) {
+      while (count <= num_of_chunks)
         cut[count++] = n;
-        j++;
-      }
-
       break;
     }
+    cut[count] = cutter.next_cut(pos + last, pos + n) - pos;
+    count++;
   }
 
   return cut[count - 1];
 }
 
 // jump by STRMIN bytes
-int chunk_gear(unsigned char *p, int n) {
-  uint32_t fingerprint = 0;
-  int i = STRMIN + 1;
-  if (n <= STRMAX) {
-    return n;
+int chunk_gear(GearCutter &cutter, int pos, int end) {
+  if (end - pos <= STRMAX) {
+    return end;
   }
-
-  while (i <= n) {
-    fingerprint = (fingerprint << 1) + GEAR[p[i]];
-    if (i <= STRMAX) {
-      if (!(fingerprint & STRAVG))
-        return i;
-    } else {
-      return i;
-    }
-    i++;
-  }
-  return i;
+  return cutter.next_cut(pos, end);
 }
 
 #ifndef PREDEFINED_GEAR_MATRIX
@@ -153,4 +130,8 @@ uint32_t GEAR[256] = {
     0x41922ad3, 0x787fb489, 0xf41c1d00, 0x3dbc3f88, 0x12a70e39, 0x26ae363d,
     0x47f7274,  0x86385074, 0x2ffb7263, 0xb8e3de33, 0x9496a61,  0x92025809,
     0xbf8b296d, 0xf1a57003, 0xa8057fb6, 0x2ce2e565, 0x56d7a64a, 0xa6e30007,
-    0xe0562996, 0xabec18bd, 0x6b8c68ed};
\ No newline at end of file
+    0xe0562996, 0xabec18bd, 0x6b8c68ed};
+
+/* The hash restarts STRMIN + 1 bytes into a string and cuts at the byte
+ * where (fingerprint & STRAVG) == 0, or STRMAX + 1 bytes in. */
+const GearParams edelta_gear = {GEAR, STRAVG, 1, 1, STRMIN + 1, STRMAX + 1};
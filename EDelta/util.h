@@ -1,6 +1,7 @@
 
 #pragma once
 #include <cstdint>
+#include "gear.h"
 #include "htable.h"
 
 #define STRMIN 12
@@ -45,9 +46,18 @@ typedef struct        /* the least write or read unit of disk */
 
 uint64_t weakHash(unsigned char *buf, int len);
 
-int chunk_gear(unsigned char *p, int n);
+/* hash[i] = weakHash of the string [cut[i], cut[i+1]) for each chunk */
+void weakHashBatch(unsigned char *data, const int *cut, int num_of_chunks,
+                   uint64_t *hash);
 
-int rolling_gear_v3(unsigned char *p, int n, int num_of_chunks, int *cut);
+/* next cut at or after @pos in the buffer of @cutter, @end if it is no
+ * more than STRMAX bytes away */
+int chunk_gear(GearCutter &cutter, int pos, int end);
+
+int rolling_gear_v3(GearCutter &cutter, int pos, int n, int num_of_chunks,
+                    int *cut);
+
+extern const GearParams edelta_gear;
 
 #ifndef PREDEFINED_GEAR_MATRIX
 void InitGearMatrix();
@@ -5,204 +5,47 @@
 using namespace std;
 
 #include "gdelta.h"
+#include "gdelta_stream.h"
+#include "gear.h"
 #include "gear_matrix.h"
+#include "hugemem.h"
+#include "mismatch.h"
 //#include "jemalloc/jemalloc.h"
 
-#pragma pack(push, 1)
-/*
- * ABI:
- *
- * VarInt<N>: more 1 | pval N [more| VarInt<7>]
- * DeltaHead: flag 1 | VarInt<6>
- * DeltaUnit: DeltaHead [DeltaHead.flag| VarInt<7>]
- *
- * VarInt <- Val, Offset = Val | VarInt[i].pval << Offset, Offset + VarInt[i]::N
- */
-template<uint8_t FLAGLEN>
-struct _DeltaHead {
-    uint8_t flag: FLAGLEN;
-    uint8_t more: 1;
-    uint8_t length: (7 - FLAGLEN);
-    const static uint8_t lenbits = FLAGLEN;
-//    const static uint8_t lenbits = (7 - FLAGLEN);
-};
-
-typedef _DeltaHead<1> DeltaHeadUnit;
-
-typedef struct _VarIntPart {
-    uint8_t more: 1;
-    uint8_t subint: 7;
-    const static uint8_t lenbits = 7;
-} VarIntPart;
-
-#pragma pack(pop)
-
-typedef struct {
-    uint8_t flag;
-    uint64_t length;
-    uint64_t offset;
-} DeltaUnitMem;
-
-// DeltaUnit/FlaggedVarInt: flag: 1, more: 1, len: 6
-// VarInt: more: 1, len: 7
-static_assert(sizeof(DeltaHeadUnit) == 1, "Expected DeltaHeads to be 1 byte");
-static_assert(sizeof(VarIntPart) == 1, "Expected VarInt to be 1 byte");
-
-
-typedef struct {
-    uint8_t *buf;
-    uint64_t cursor;
-    uint64_t length;
-} BufferStreamDescriptor;
-
-void ensure_stream_length(BufferStreamDescriptor &stream, size_t length) {
-    if (length > stream.length) {
-        stream.buf = (uint8_t *) realloc(stream.buf, length);
-        stream.length = length;
-    }
-}
-
-template<typename T>
-void write_field(BufferStreamDescriptor &buffer, const T &field) {
-    ensure_stream_length(buffer, buffer.cursor + sizeof(T));
-    memcpy(buffer.buf + buffer.cursor, &field, sizeof(T));
-    buffer.cursor += sizeof(T);
-    // TODO: check bounds (buffer->length)?
-}
-
-
-template<typename T>
-void read_field(BufferStreamDescriptor &buffer, T &field) {
-    memcpy(&field, buffer.buf + buffer.cursor, sizeof(T));
-    buffer.cursor += sizeof(T);
-    // TODO: check bounds (buffer->length)?
-}
-
-inline
-void stream_into(BufferStreamDescriptor &dest, BufferStreamDescriptor &src, size_t length) {
-    ensure_stream_length(dest, dest.cursor + length);
-    memcpy(dest.buf + dest.cursor, src.buf + src.cursor, length);
-    dest.cursor += length;
-    src.cursor += length;
-}
-
-inline
-void stream_from(BufferStreamDescriptor &dest, const BufferStreamDescriptor &src, size_t src_cursor, size_t length) {
-    ensure_stream_length(dest, dest.cursor + length);
-    memcpy(dest.buf + dest.cursor, src.buf + src_cursor, length);
-    dest.cursor += length;
-}
-
-inline
-void write_concat_buffer(BufferStreamDescriptor &dest, const BufferStreamDescriptor &src) {
-    ensure_stream_length(dest, dest.cursor + src.cursor + 1);
-    memcpy(dest.buf + dest.cursor, src.buf, src.cursor);
-    dest.cursor += src.cursor;
-}
-
-inline
-uint64_t read_varint(BufferStreamDescriptor &buffer) {
-    VarIntPart vi;
-    uint64_t val = 0;
-    uint8_t offset = 0;
-    do {
-        read_field(buffer, vi);
-        val |= vi.subint << offset;
-        offset += VarIntPart::lenbits;
-    } while (vi.more);
-    return val;
-}
-
-inline
-void read_unit(BufferStreamDescriptor &buffer, DeltaUnitMem &unit) {
-    DeltaHeadUnit head;
-    read_field(buffer, head);
-
-    unit.flag = head.flag;
-    unit.length = head.length;
-    if (head.more) {
-        unit.length = read_varint(buffer) << DeltaHeadUnit::lenbits | unit.length;
-    }
-    if (head.flag) {
-        unit.offset = read_varint(buffer);
-    }
-#if DEBUG_UNITS
-    fprintf(stderr, "Reading unit %d %zu %zu\n", unit.flag, unit.length, unit.offset);
-#endif
-}
-
-const uint8_t varint_mask = ((1 << VarIntPart::lenbits) - 1);
-const uint8_t head_varint_mask = ((1 << DeltaHeadUnit::lenbits) - 1);
-
-void write_varint(BufferStreamDescriptor &buffer, uint64_t val) {
-    VarIntPart vi;
-    do {
-        vi.subint = val & varint_mask;
-        val >>= VarIntPart::lenbits;
-        if (val == 0) {
-            vi.more = 0;
-            write_field(buffer, vi);
-            break;
-        }
-        vi.more = 1;
-        write_field(buffer, vi);
-    } while (1);
-}
-
-void write_unit(BufferStreamDescriptor &buffer, const DeltaUnitMem &unit) {
-    // TODO: Abort if length 0?
-#if DEBUG_UNITS
-    fprintf(stderr, "Writing unit %d %zu %zu\n", unit.flag, unit.length, unit.offset);
-#endif
-
-    DeltaHeadUnit head = {unit.flag, unit.length > head_varint_mask, (uint8_t) (unit.length & head_varint_mask)};
-    write_field(buffer, head);
-//  cout<<head_varint_mask<<endl;
-    uint64_t remaining_length = unit.length >> DeltaHeadUnit::lenbits;
-    if (remaining_length)
-        write_varint(buffer, remaining_length);
-//  write_varint(buffer, remaining_length);
-    if (unit.flag) {
-        write_varint(buffer, unit.offset);
-    }
-}
+/* The rolling hash over WordSize bytes: each step shifts by 64 / WordSize */
+template<int WordSize>
+constexpr GearWindow64 gdelta_window = {GEARmx, sizeof(FPTYPE) * 8 / WordSize};
 
+const GearWindow64 gdelta_gear = gdelta_window<8>;
 
-void GFixSizeChunking(unsigned char *data, int len, int begflag, int begsize,
+/* Index every Step-th window of WordSize bytes. The rolling values come
+ * from the shared Gear kernel (gear.h) one block at a time; it takes a
+ * WordSize of 2, 4 or 8. */
+template<int WordSize, int Step>
+void GSampledChunking(unsigned char *data, int len, int begflag, int begsize,
                       uint32_t *hash_table, int mask, uint64_t hashMask) {
+    static_assert(WordSize == 2 || WordSize == 4 || WordSize == 8,
+                  "gear_rolling64 shifts by 8, 16 or 32");
     if (len < WordSize)
         return;
 
-    int i = 0;
-    int movebitlength = sizeof(FPTYPE) * 8 / WordSize;
-    if (sizeof(FPTYPE) * 8 % WordSize != 0)
-        movebitlength++;
-    FPTYPE fingerprint = 0;
-
-    /** GEAR **/
-    for (; i < WordSize; i++) {
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i]];
-    }
-
-    i -= WordSize;
-    FPTYPE index = 0;
-    int numChunks = len - WordSize;
+    const int block = 64 * Step;
+    FPTYPE fingerprints[block];
+    int numChunks = len - WordSize - (Step - 1);
 
     int _begsize = begflag ? begsize : 0;
     int indexMoveLength = (sizeof(FPTYPE) * 8 - mask);
 
-    while (i < numChunks) {
-        index = (fingerprint) >> indexMoveLength;
-        hash_table[index] = i + _begsize;
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize]];
-        i++;
-
+    for (int b = 0; b < numChunks; b += block) {
+        int n = min(block, numChunks - b);
+        gear_rolling64(gdelta_window<WordSize>, data, b + WordSize - 1,
+                       b + WordSize - 1 + n, fingerprints);
+        for (int i = 0; i < n; i += Step)
+            hash_table[fingerprints[i] >> indexMoveLength] = b + i + _begsize;
     }
-
-    return;
 }
 
-
+template<int WordSize>
 void GFixSizeChunking2(unsigned char *data, int len, int begflag, int begsize,
                        uint32_t *hash_table, int mask, uint64_t hashMask) {
     if (len < WordSize)
@@ -234,79 +77,36 @@ void GFixSizeChunking2(unsigned char *data, int len, int begflag, int begsize,
     }
 }
 
-void GFixSizeChunking_3(unsigned char *data, int len, int begflag, int begsize,
-                      uint32_t *hash_table, int mask, uint64_t hashMask) {
-    if (len < WordSize)
-        return;
-
-    int i = 0;
-    int movebitlength = sizeof(FPTYPE) * 8 / WordSize;
-    if (sizeof(FPTYPE) * 8 % WordSize != 0)
-        movebitlength++;
-    FPTYPE fingerprint = 0;
-
-    /** GEAR **/
-    for (; i < WordSize; i++) {
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i]];
-    }
-
-    i -= WordSize;
-    FPTYPE index = 0;
-    int numChunks = len - WordSize - 2;
-
-
-    int _begsize = begflag ? begsize : 0;
-    int indexMoveLength = (sizeof(FPTYPE) * 8 - mask);
-
-    while (i < numChunks) {
-        index = (fingerprint) >> indexMoveLength;
-        hash_table[index] = i + _begsize;
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize]];
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize + 1]];
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize + 2]];
-        i+=3;
-    }
-}
-
-void GFixSizeChunking_4(unsigned char *data, int len, int begflag, int begsize,
-                        uint32_t *hash_table, int mask, uint64_t hashMask) {
-    if (len < WordSize)
-        return;
-
-    int i = 0;
-    int movebitlength = sizeof(FPTYPE) * 8 / WordSize;
-    if (sizeof(FPTYPE) * 8 % WordSize != 0)
-        movebitlength++;
-    FPTYPE fingerprint = 0;
-
-    /** GEAR **/
-    for (; i < WordSize; i++) {
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i]];
-    }
-
-    i -= WordSize;
-    FPTYPE index = 0;
-    int numChunks = len - WordSize - 3;
-
-    int flag = 0;
-    int _begsize = begflag ? begsize : 0;
-    int indexMoveLength = (sizeof(FPTYPE) * 8 - mask);
-
-    while (i < numChunks) {
-        index = (fingerprint) >> indexMoveLength;
-        hash_table[index] = i + _begsize;
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize]];
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize + 1]];
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize + 2]];
-        fingerprint = (fingerprint << (movebitlength)) + GEARmx[data[i + WordSize + 3]];
-        i+=4;
+/* Distance between two sampled base positions; a BaseSampleRate of 0
+ * indexes every position */
+template<int WordSize, int BaseSampleRate>
+constexpr int IndexStep =
+    ((BaseSampleRate == 2 && WordSize == 64) || BaseSampleRate == 3 || BaseSampleRate == 4)
+        ? BaseSampleRate : 1;
+
+template<int WordSize, int BaseSampleRate>
+void GIndexBase(unsigned char *data, int len, int begflag, int begsize,
+                uint32_t *hash_table, int mask, uint64_t hashMask) {
+    if constexpr (BaseSampleRate == 2 && WordSize == 64)
+    {
+        GFixSizeChunking2<WordSize>(data, len, begflag, begsize, hash_table, mask, hashMask);
+    } else
+    {
+        GSampledChunking<WordSize, IndexStep<WordSize, BaseSampleRate>>(
+            data, len, begflag, begsize, hash_table, mask, hashMask);
     }
-
 }
 
-
-int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
-            uint32_t baseSize, uint8_t **deltaBuf, uint32_t *deltaSize) {
+/*
+ * gencode with its tuning knobs as template parameters, so that every
+ * variant keeps them folded into its loops: the hash window is WordSize
+ * bytes, the base index samples every BaseSampleRate-th window (see
+ * IndexStep), SkipOn skips ahead faster the longer no match is found, and
+ * ReverseMatch extends a failed lookup backwards from the end of the window.
+ */
+template<int WordSize, int BaseSampleRate, bool SkipOn, bool ReverseMatch>
+static int gencodeT(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
+                    uint32_t baseSize, uint8_t **deltaBuf, uint32_t *deltaSize) {
 #if PRINT_PERF
     struct timespec tf0, tf1;
     clock_gettime(CLOCK_MONOTONIC, &tf0);
@@ -320,23 +120,12 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
     }
 
 
-    uint8_t *databuf = (uint8_t *) malloc(INIT_BUFFER_SIZE);
-    uint8_t *instbuf = (uint8_t *) malloc(INIT_BUFFER_SIZE);
+    uint8_t *databuf = (uint8_t *) hugemem_alloc(INIT_BUFFER_SIZE);
+    uint8_t *instbuf = (uint8_t *) hugemem_alloc(INIT_BUFFER_SIZE);
 
 
     // Find first difference
-    // First in 8 byte blocks and then in 1 byte blocks for speed
-    while (begSize + sizeof(uint64_t) <= baseSize &&
-           begSize + sizeof(uint64_t) <= newSize &&
-           *(uint64_t *) (baseBuf + begSize) == *(uint64_t *) (newBuf + begSize)) {
-        begSize += sizeof(uint64_t);
-    }
-
-    while (begSize < baseSize &&
-           begSize < newSize &&
-           baseBuf[begSize] == newBuf[begSize]) {
-        begSize++;
-    }
+    begSize = match_forward(baseBuf, newBuf, min(baseSize, newSize));
 
     if (begSize > 16)
         beg = 1;
@@ -344,18 +133,8 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
         begSize = 0;
 
     // Find first difference (from the end)
-    while (endSize + sizeof(uint64_t) <= baseSize &&
-           endSize + sizeof(uint64_t) <= newSize &&
-           *(uint64_t *) (baseBuf + baseSize - endSize - sizeof(uint64_t)) ==
-           *(uint64_t *) (newBuf + newSize - endSize - sizeof(uint64_t))) {
-        endSize += sizeof(uint64_t);
-    }
-
-    while (endSize < baseSize &&
-           endSize < newSize &&
-           baseBuf[baseSize - endSize - 1] == newBuf[newSize - endSize - 1]) {
-        endSize++;
-    }
+    endSize = match_backward(baseBuf + baseSize, newBuf + newSize,
+                             min(baseSize, newSize));
 
     if (begSize + endSize > newSize)
         endSize = newSize - begSize;
@@ -367,8 +146,8 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
     /* end of detect */
 
     BufferStreamDescriptor deltaStream = {*deltaBuf, 0, ChunkSize};
-    BufferStreamDescriptor instStream = {instbuf, 0, INIT_BUFFER_SIZE}; // Instruction stream
-    BufferStreamDescriptor dataStream = {databuf, 0, INIT_BUFFER_SIZE};
+    BufferStreamDescriptor instStream = {instbuf, 0, INIT_BUFFER_SIZE, true}; // Instruction stream
+    BufferStreamDescriptor dataStream = {databuf, 0, INIT_BUFFER_SIZE, true};
     BufferStreamDescriptor newStream = {newBuf, begSize, newSize};
     DeltaUnitMem unit = {}; // In-memory represtation of current working unit
 
@@ -403,8 +182,8 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
         *deltaSize = deltaStream.cursor;
         *deltaBuf = deltaStream.buf;
 
-        free(dataStream.buf);
-        free(instStream.buf);
+        hugemem_free(dataStream.buf);
+        hugemem_free(instStream.buf);
         return deltaStream.cursor;
     }
 
@@ -442,7 +221,7 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
 
 
     isFindMatch = true;
-    hash_table = (uint32_t *) malloc(hash_size * sizeof(uint32_t));
+    hash_table = (uint32_t *) hugemem_alloc(hash_size * sizeof(uint32_t));
     memset(hash_table, 0, sizeof(uint32_t) * hash_size);
 
 
@@ -452,24 +231,7 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
 #endif
 
 
-#ifdef BaseSampleRate
-    if(BaseSampleRate == 2 && WordSize == 64)
-    {
-        GFixSizeChunking2(baseBuf + begSize, baseSize - begSize - endSize, beg, begSize, hash_table, bit, hashMask);
-    }else if(BaseSampleRate == 3)
-    {
-        GFixSizeChunking_3(baseBuf + begSize, baseSize - begSize - endSize, beg, begSize, hash_table, bit, hashMask);
-    }else if(BaseSampleRate == 4)
-    {
-        GFixSizeChunking_4(baseBuf + begSize, baseSize - begSize - endSize, beg, begSize, hash_table, bit, hashMask);
-    } else
-    {
-        GFixSizeChunking(baseBuf + begSize, baseSize - begSize - endSize, beg, begSize, hash_table, bit, hashMask);
-    }
-
-#else
-    GFixSizeChunking(baseBuf + begSize, baseSize - begSize - endSize, beg, begSize, hash_table, bit, hashMask);
-#endif
+    GIndexBase<WordSize, BaseSampleRate>(baseBuf + begSize, baseSize - begSize - endSize, beg, begSize, hash_table, bit, hashMask);
 
 
 #if PRINT_PERF
@@ -518,31 +280,19 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
             offset = baseoffset;
         }
 
-#ifdef ReverseMatch
-        if (baseoffset != 0 && !matchflag) {
-
-            uint32_t i = length;
-            uint8_t *basepos_end = baseBuf + baseoffset + length - 1;
-            uint8_t *inputpos_end = newBuf + inputPos + length - 1;
-            for (; i > 0 && (*basepos_end == *inputpos_end); i--, basepos_end--, inputpos_end--) {
-            }
+        if (ReverseMatch && baseoffset != 0 && !matchflag) {
 
-            uint32_t matchlen_end = length - i;
+            uint32_t matchlen_end = match_backward(baseBuf + baseoffset + length,
+                                                   newBuf + inputPos + length, length);
+            uint32_t i = length - matchlen_end;
 
             if (matchlen_end > WordSize / 2) {
 
                 int j = 0;
-                {
-                    uint8_t *p1 = baseBuf + baseoffset + length;
-                    uint8_t *p2 = newBuf + inputPos + length;
-                    uint32_t *basepos_end1 = (uint32_t *) p1;
-                    uint32_t *inputpos_end1 = (uint32_t *) p2;
-
-                    for (; p1 + 3 + j < baseBuf + baseSize &&
-                           p2 + 3 + j < newBuf + newSize - endSize &&
-                           (*basepos_end1 == *inputpos_end1); j += 4, basepos_end1++, inputpos_end1++) {
-                    }
-
+                if (baseoffset + length < baseSize) {
+                    j = match_forward_padded(baseBuf + baseoffset + length, newBuf + inputPos + length,
+                                             min(baseSize - baseoffset - length,
+                                                 newSize - endSize - inputPos - length));
                 }
                 unit.flag = false;
                 unit.length += i;
@@ -550,7 +300,7 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
                 write_unit(instStream, unit);
 
                 unit.flag = true;
-                unit.offset = (basepos_end - baseBuf + 1);
+                unit.offset = baseoffset + i;
                 unit.length = matchlen_end + j;
 
                 write_unit(instStream, unit);
@@ -566,7 +316,6 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
                 continue;
             }
         }
-#endif
 
 
         /* New data match found in hashtable/base data; attempt to create copy instruction*/
@@ -574,18 +323,11 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
             matchNum++;
             // Check how much is possible to copy
             int32_t j = 0;
-#if 1 /* 8-bytes optimization */
-            while (offset + length + j + 7 < baseSize - endSize &&
-                   cursor + j + 7 < newSize - endSize &&
-                   *(uint64_t *) (baseBuf + offset + length + j) == *(uint64_t *) (newBuf + cursor + j)) {
-                j += sizeof(uint64_t);
+            if (offset + length < baseSize - endSize && cursor < newSize - endSize) {
+                j = match_forward_padded(baseBuf + offset + length, newBuf + cursor,
+                                         min(baseSize - endSize - offset - length,
+                                             newSize - endSize - cursor));
             }
-            while (offset + length + j < baseSize - endSize &&
-                   cursor + j < newSize - endSize &&
-                   baseBuf[offset + length + j] == newBuf[cursor + j]) {
-                j++;
-            }
-#endif
             cursor += j;
 
             int32_t matchlen = cursor - inputPos;
@@ -595,13 +337,8 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
             // Check if switching modes Literal -> Copy, and dump instruction if available
             if (!unit.flag && unit.length) {
                 /* Detect if end of previous literal could have been a partial copy*/
-                uint32_t k = 0;
-                while (k + 1 <= offset && k + 1 <= unit.length) {
-                    if (baseBuf[offset - (k + 1)] == newBuf[inputPos - (k + 1)])
-                        k++;
-                    else
-                        break;
-                }
+                uint32_t k = match_backward(baseBuf + offset, newBuf + inputPos,
+                                            min(offset, (uint32_t) unit.length));
 
                 if (k > 0) {
                     // Reduce literal by the amount covered by the copy
@@ -648,35 +385,35 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
                 fingerprint = (fingerprint << (moveBitLength)) + GEARmx[newBuf[inputPos + WordSize]];
             }
             inputPos++;
-#ifdef SkipOn
-            int step = ((inputPos - lastMatchPos) >> SkipStep) ;
+            if (SkipOn) {
+                int step = ((inputPos - lastMatchPos) >> SkipStep) ;
 
-            if(step <= WordSize)
-            {
-                for(int i = 0; i < step && (inputPos + WordSize < newSize - endSize); i++,inputPos++)
+                if(step <= WordSize)
                 {
-                    fingerprint = (fingerprint << (moveBitLength)) + GEARmx[newBuf[inputPos + WordSize]];
-                    handleBytes += 1;
-                    unit.length += 1;
+                    for(int i = 0; i < step && (inputPos + WordSize < newSize - endSize); i++,inputPos++)
+                    {
+                        fingerprint = (fingerprint << (moveBitLength)) + GEARmx[newBuf[inputPos + WordSize]];
+                        handleBytes += 1;
+                        unit.length += 1;
+                    }
                 }
-            }
-            else
-            {
-                fingerprint = 0;
-                int cursor = inputPos + step;
-                int len = 0;
-                for(int i = 0; i < WordSize && (cursor + i < newSize - endSize); i++)
+                else
                 {
-                    fingerprint = (fingerprint << (moveBitLength)) + GEARmx[newBuf[cursor + i]];
-                    len++;
+                    fingerprint = 0;
+                    int cursor = inputPos + step;
+                    int len = 0;
+                    for(int i = 0; i < WordSize && (cursor + i < newSize - endSize); i++)
+                    {
+                        fingerprint = (fingerprint << (moveBitLength)) + GEARmx[newBuf[cursor + i]];
+                        len++;
+                    }
+                    int l = min(newSize - endSize, inputPos + step);
+                    int realStep = l - inputPos;
+                    handleBytes += realStep;
+                    unit.length += realStep;
+                    inputPos += realStep;
                 }
-                int l = min(newSize - endSize, inputPos + step);
-                int realStep = l - inputPos;
-                handleBytes += realStep;
-                unit.length += realStep;
-                inputPos += realStep;
             }
-#endif
         }
     }
 
@@ -735,10 +472,9 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
     fprintf(stderr, "gencode took: %zdns\n", (tf1.tv_sec - tf0.tv_sec) * 1000000000 + tf1.tv_nsec - tf0.tv_nsec);
 #endif
 
-    free(dataStream.buf);
-    free(instStream.buf);
-    if (hash_table)
-        free(hash_table);
+    hugemem_free(dataStream.buf);
+    hugemem_free(instStream.buf);
+    hugemem_free(hash_table);
 
 
     return deltaStream.cursor;
@@ -746,6 +482,37 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
 
 
 
+template<int WordSize, int BaseSampleRate>
+static void gindexT(uint8_t *base, uint32_t len, uint32_t *hash_table, int bits) {
+    GIndexBase<WordSize, BaseSampleRate>(base, len, 0, 0, hash_table, bits,
+                                         0XFFFFFFFFFFFFFFFF >> (64 - bits));
+}
+
+/* The curated parameter sets; "default" is the one gencode runs */
+const GDeltaVariant gdelta_variants[] = {
+    {"default", gencodeT<8, 3, true, true>, gindexT<8, 3>},
+    {"s1", gencodeT<8, 0, true, true>, gindexT<8, 0>},  // index every base position
+    {"s4", gencodeT<8, 4, true, true>, gindexT<8, 4>},
+    {"w4", gencodeT<4, 3, true, true>, gindexT<4, 3>},  // 4-byte hash window
+    {"noskip", gencodeT<8, 3, false, true>, gindexT<8, 3>},
+    {"noreverse", gencodeT<8, 3, true, false>, gindexT<8, 3>},
+};
+const size_t gdelta_variant_count = sizeof(gdelta_variants) / sizeof(gdelta_variants[0]);
+
+const GDeltaVariant *gdelta_find_variant(const char *name) {
+    for (size_t i = 0; i < gdelta_variant_count; i++) {
+        if (strcmp(name, gdelta_variants[i].name) == 0)
+            return &gdelta_variants[i];
+    }
+    return nullptr;
+}
+
+int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
+            uint32_t baseSize, uint8_t **deltaBuf, uint32_t *deltaSize) {
+    return gencodeT<8, 3, true, true>(newBuf, newSize, baseBuf, baseSize, deltaBuf, deltaSize);
+}
+
+
 int gdecode(uint8_t *deltaBuf, uint32_t deltaSize, uint8_t *baseBuf, uint32_t baseSize,
             uint8_t **outBuf, uint32_t *outSize) {
 
@@ -2,23 +2,24 @@
 #define GDELTA_GDELTA_H
 using namespace std;
 #include <iostream>
+#include <cstddef>
 #include <cstdint>
 
+#include "gear.h"
+
 /*****Parameter*****/
 #define ChunkSize (1024 * 1024 * 20)
 #define INIT_BUFFER_SIZE (1024 * 1024 * 20)
 #define FPTYPE uint64_t
 //#define FPTYPE uint32_t
-#define WordSize 8
 #define SkipStep 2
-#define SkipOn
-#define BaseSampleRate 3
-#define ReverseMatch
 /*****Parameter*****/
 
 #define PRINT_PERF 0
 #define DEBUG_UNITS 0
 
+/* newBuf and baseBuf stay readable for MISMATCH_OVERREAD bytes past their
+ * ends (mismatch.h), as DeltaEncoder's buffers do */
 int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
             uint32_t baseSize, uint8_t **deltaBuf, uint32_t *deltaSize);
 
@@ -26,6 +27,31 @@ int gencode(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
 int gdecode(uint8_t *deltaBuf, uint32_t deltaSize, uint8_t *baseBuf,
             uint32_t baseSize, uint8_t **outBuf, uint32_t *outSize);
 
+/* WordSize, BaseSampleRate, SkipOn and ReverseMatch are template parameters
+ * of gencode's variants (gdelta.cpp); gencode runs the "default" one, with
+ * an 8-byte window, every third base position indexed, skipping and
+ * reverse matching on. */
+typedef int (*gencode_fn)(uint8_t *newBuf, uint32_t newSize, uint8_t *baseBuf,
+                          uint32_t baseSize, uint8_t **deltaBuf, uint32_t *deltaSize);
+
+/* Each has the contract of gencode, and gdecode reads all of them */
+struct GDeltaVariant {
+    const char *name;
+    gencode_fn encode;
+    /* The base index alone, as gencode builds it: hash_table has 1 << bits
+     * slots (delta_microbench) */
+    void (*index)(uint8_t *base, uint32_t len, uint32_t *hash_table, int bits);
+};
+
+extern const GDeltaVariant gdelta_variants[];
+extern const size_t gdelta_variant_count;
+
+/* nullptr if no variant has that name */
+const GDeltaVariant *gdelta_find_variant(const char *name);
+
+/* Rolling hash of the default base index: the window is 8 bytes */
+extern const GearWindow64 gdelta_gear;
+
 
 
 #endif // GDELTA_GDELTA_H
@@ -0,0 +1,178 @@
+#ifndef GDELTA_GDELTA_STREAM_H
+#define GDELTA_GDELTA_STREAM_H
+/* Delta units and the byte streams gencode and gdecode build them in;
+ * shared with delta_microbench. */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "gdelta.h"
+#include "hugemem.h"
+
+#pragma pack(push, 1)
+/*
+ * ABI:
+ *
+ * VarInt<N>: more 1 | pval N [more| VarInt<7>]
+ * DeltaHead: flag 1 | VarInt<6>
+ * DeltaUnit: DeltaHead [DeltaHead.flag| VarInt<7>]
+ *
+ * VarInt <- Val, Offset = Val | VarInt[i].pval << Offset, Offset + VarInt[i]::N
+ */
+template<uint8_t FLAGLEN>
+struct _DeltaHead {
+    uint8_t flag: FLAGLEN;
+    uint8_t more: 1;
+    uint8_t length: (7 - FLAGLEN);
+    const static uint8_t lenbits = FLAGLEN;
+//    const static uint8_t lenbits = (7 - FLAGLEN);
+};
+
+typedef _DeltaHead<1> DeltaHeadUnit;
+
+typedef struct _VarIntPart {
+    uint8_t more: 1;
+    uint8_t subint: 7;
+    const static uint8_t lenbits = 7;
+} VarIntPart;
+
+#pragma pack(pop)
+
+typedef struct {
+    uint8_t flag;
+    uint64_t length;
+    uint64_t offset;
+} DeltaUnitMem;
+
+// DeltaUnit/FlaggedVarInt: flag: 1, more: 1, len: 6
+// VarInt: more: 1, len: 7
+static_assert(sizeof(DeltaHeadUnit) == 1, "Expected DeltaHeads to be 1 byte");
+static_assert(sizeof(VarIntPart) == 1, "Expected VarInt to be 1 byte");
+
+
+typedef struct {
+    uint8_t *buf;
+    uint64_t cursor;
+    uint64_t length;
+    bool scratch; // buf is from hugemem_alloc
+} BufferStreamDescriptor;
+
+inline
+void ensure_stream_length(BufferStreamDescriptor &stream, size_t length) {
+    if (length > stream.length) {
+        stream.buf = (uint8_t *) (stream.scratch ? hugemem_realloc(stream.buf, length)
+                                                 : realloc(stream.buf, length));
+        stream.length = length;
+    }
+}
+
+template<typename T>
+void write_field(BufferStreamDescriptor &buffer, const T &field) {
+    ensure_stream_length(buffer, buffer.cursor + sizeof(T));
+    memcpy(buffer.buf + buffer.cursor, &field, sizeof(T));
+    buffer.cursor += sizeof(T);
+    // TODO: check bounds (buffer->length)?
+}
+
+
+template<typename T>
+void read_field(BufferStreamDescriptor &buffer, T &field) {
+    memcpy(&field, buffer.buf + buffer.cursor, sizeof(T));
+    buffer.cursor += sizeof(T);
+    // TODO: check bounds (buffer->length)?
+}
+
+inline
+void stream_into(BufferStreamDescriptor &dest, BufferStreamDescriptor &src, size_t length) {
+    ensure_stream_length(dest, dest.cursor + length);
+    memcpy(dest.buf + dest.cursor, src.buf + src.cursor, length);
+    dest.cursor += length;
+    src.cursor += length;
+}
+
+inline
+void stream_from(BufferStreamDescriptor &dest, const BufferStreamDescriptor &src, size_t src_cursor, size_t length) {
+    ensure_stream_length(dest, dest.cursor + length);
+    memcpy(dest.buf + dest.cursor, src.buf + src_cursor, length);
+    dest.cursor += length;
+}
+
+inline
+void write_concat_buffer(BufferStreamDescriptor &dest, const BufferStreamDescriptor &src) {
+    ensure_stream_length(dest, dest.cursor + src.cursor + 1);
+    memcpy(dest.buf + dest.cursor, src.buf, src.cursor);
+    dest.cursor += src.cursor;
+}
+
+inline
+uint64_t read_varint(BufferStreamDescriptor &buffer) {
+    VarIntPart vi;
+    uint64_t val = 0;
+    uint8_t offset = 0;
+    do {
+        read_field(buffer, vi);
+        val |= vi.subint << offset;
+        offset += VarIntPart::lenbits;
+    } while (vi.more);
+    return val;
+}
+
+inline
+void read_unit(BufferStreamDescriptor &buffer, DeltaUnitMem &unit) {
+    DeltaHeadUnit head;
+    read_field(buffer, head);
+
+    unit.flag = head.flag;
+    unit.length = head.length;
+    if (head.more) {
+        unit.length = read_varint(buffer) << DeltaHeadUnit::lenbits | unit.length;
+    }
+    if (head.flag) {
+        unit.offset = read_varint(buffer);
+    }
+#if DEBUG_UNITS
+    fprintf(stderr, "Reading unit %d %zu %zu\n", unit.flag, unit.length, unit.offset);
+#endif
+}
+
+const uint8_t varint_mask = ((1 << VarIntPart::lenbits) - 1);
+const uint8_t head_varint_mask = ((1 << DeltaHeadUnit::lenbits) - 1);
+
+inline
+void write_varint(BufferStreamDescriptor &buffer, uint64_t val) {
+    VarIntPart vi;
+    do {
+        vi.subint = val & varint_mask;
+        val >>= VarIntPart::lenbits;
+        if (val == 0) {
+            vi.more = 0;
+            write_field(buffer, vi);
+            break;
+        }
+        vi.more = 1;
+        write_field(buffer, vi);
+    } while (1);
+}
+
+inline
+void write_unit(BufferStreamDescriptor &buffer, const DeltaUnitMem &unit) {
+    // TODO: Abort if length 0?
+#if DEBUG_UNITS
+    fprintf(stderr, "Writing unit %d %zu %zu\n", unit.flag, unit.length, unit.offset);
+#endif
+
+    DeltaHeadUnit head = {unit.flag, unit.length > head_varint_mask, (uint8_t) (unit.length & head_varint_mask)};
+    write_field(buffer, head);
+//  cout<<head_varint_mask<<endl;
+    uint64_t remaining_length = unit.length >> DeltaHeadUnit::lenbits;
+    if (remaining_length)
+        write_varint(buffer, remaining_length);
+//  write_varint(buffer, remaining_length);
+    if (unit.flag) {
+        write_varint(buffer, unit.offset);
+    }
+}
+
+#endif // GDELTA_GDELTA_STREAM_H
@@ -4,15 +4,25 @@
 #include <cstdlib>
 
 #include "fdelta_interface.h"
-constexpr uint64_t CMP_LENGTH = 128;
-constexpr uint64_t CMP_LENGTH_SHORT = 8;
+#include "mismatch.h"
 
 uint8_t* lz4Buffer = new uint8_t[1024 * 64];  // 64KB buffer for LZ4 compression
 uint64_t lz4Size = 0;
 
-uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
-                 unsigned char* baseBuf, uint64_t baseSize,
-                 unsigned char* outputBuf) {
+// fencode with its tuning constants as template parameters, so that every
+// variant keeps them folded into its loops (the fingerprint length reaches
+// XXH3 as a constant, for one). A probe needs CmpLength bytes left in both
+// streams; a chunk's fingerprint covers its last HashLength bytes; the tiny
+// index takes NumberOfChunks base chunks, CHUNKS_MULTIPLIER times as many
+// on the second try; chunks are cut at MaxChunkSize bytes.
+template <uint64_t CmpLength, uint64_t HashLength, uint64_t NumberOfChunks,
+          uint32_t MaxChunkSize>
+static uint64_t fencodeT(unsigned char* inputBuf, uint64_t inputSize,
+                         unsigned char* baseBuf, uint64_t baseSize,
+                         unsigned char* outputBuf) {
+    static_assert(HashLength >= 8, "matches are aligned 8 bytes before a cut");
+    static_assert(NumberOfChunks * CHUNKS_MULTIPLIER <= TinyMapSIMD::kCap,
+                  "the tiny index holds kCap chunks");
     const unsigned char* const in = (const unsigned char*)inputBuf;
     const unsigned char* const base = (const unsigned char*)baseBuf;
     deltaPtr = outputBuf;
@@ -26,14 +36,9 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
 
     // absolute last positions where an N‑byte compare is still valid
     const unsigned char* inEnd128Abs =
-        (curInputSize >= CMP_LENGTH) ? inEnd - CMP_LENGTH : inBeg;
+        (curInputSize >= CmpLength) ? inEnd - CmpLength : inBeg;
     const unsigned char* baseEnd128Abs =
-        (curBaseSize >= CMP_LENGTH) ? baseEnd - CMP_LENGTH : baseBeg;
-    const unsigned char* inEnd8Abs =
-        (curInputSize >= CMP_LENGTH_SHORT) ? inEnd - CMP_LENGTH_SHORT : inBeg;
-    const unsigned char* baseEnd8Abs = (curBaseSize >= CMP_LENGTH_SHORT)
-                                           ? baseEnd - CMP_LENGTH_SHORT
-                                           : baseBeg;
+        (curBaseSize >= CmpLength) ? baseEnd - CmpLength : baseBeg;
 
 
     uint64_t offset = 0;  // canonical positions
@@ -51,6 +56,11 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
     std::vector<GapOp> opQueue;
     opQueue.reserve(1024);
 
+    GearParams gear = fdelta_gear;
+    gear.max_len = MaxChunkSize;
+    GearCutter baseCut(gear, baseBuf);
+    GearCutter inputCut(gear, inputBuf);
+
     auto queueADD = [&](const unsigned char* data, size_t len) {
         if (len == 0) return;
         opQueue.push_back({GapOp::ADD, data, 0, len});
@@ -68,25 +78,15 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
             break;
         }
 
-        // ---- forward match with fixed sizes (128 then 8) ----
+        // ---- forward match up to the first differing byte ----
         const unsigned char* pIn = inBeg + offset;
         const unsigned char* pBase = baseBeg + baseOffset;
 
-        while (pIn <= inEnd128Abs && pBase <= baseEnd128Abs &&
-               //    std::memcmp(pIn, pBase, CMP_LENGTH) == 0)
-               (memeq_128(pIn, pBase))) {
-            pIn += CMP_LENGTH;
-            pBase += CMP_LENGTH;
-        }
-        while (pIn <= inEnd8Abs && pBase <= baseEnd8Abs &&
-               (*(uint64_t*)pIn ^ *(uint64_t*)pBase) == 0) {
-            pIn += CMP_LENGTH_SHORT;
-            pBase += CMP_LENGTH_SHORT;
-        }
-
         // if we advanced, emit COPY for the matched run
         {
-            uint64_t advanced = static_cast<uint64_t>(pIn - (inBeg + offset));
+            uint64_t advanced = match_forward_padded(
+                pIn, pBase,
+                std::min<uint64_t>(inEnd - pIn, baseEnd - pBase));
             if (advanced != 0) {
                 queueCOPY(baseOffset, advanced);
                 offset += advanced;
@@ -99,26 +99,12 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
         const unsigned char* lowerBase = baseBeg + baseOffset;
         const unsigned char* tailIn = inEnd;
         const unsigned char* tailBase = baseEnd;
-
-        while (tailIn >= lowerIn + CMP_LENGTH &&
-               tailBase >= lowerBase + CMP_LENGTH &&
-               memeq_128(tailIn - CMP_LENGTH, tailBase - CMP_LENGTH)) {
-            tailIn -= CMP_LENGTH;
-            tailBase -= CMP_LENGTH;
-        }
-        while (tailIn >= lowerIn + 8 && tailBase >= lowerBase + 8) {
-            uint64_t a = load_u64(tailIn - 8);
-            uint64_t b = load_u64(tailBase - 8);
-            if (a != b) break;
-            tailIn -= 8;
-            tailBase -= 8;
-        }
-        while (tailIn > lowerIn && tailBase > lowerBase) {
-            const unsigned char a = *(tailIn - 1);
-            const unsigned char b = *(tailBase - 1);
-            if (a != b) break;
-            --tailIn;
-            --tailBase;
+        {
+            uint64_t back = match_backward(
+                tailIn, tailBase,
+                std::min<uint64_t>(tailIn - lowerIn, tailBase - lowerBase));
+            tailIn -= back;
+            tailBase -= back;
         }
 
         uint64_t newSuffixLen = static_cast<uint64_t>(inEnd - tailIn);
@@ -130,15 +116,9 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
             inEnd = tailIn;
             baseEnd = tailBase;
             inEnd128Abs =
-                (curInputSize >= CMP_LENGTH) ? inEnd - CMP_LENGTH : inBeg;
+                (curInputSize >= CmpLength) ? inEnd - CmpLength : inBeg;
             baseEnd128Abs =
-                (curBaseSize >= CMP_LENGTH) ? baseEnd - CMP_LENGTH : baseBeg;
-            inEnd8Abs = (curInputSize >= CMP_LENGTH_SHORT)
-                            ? inEnd - CMP_LENGTH_SHORT
-                            : inBeg;
-            baseEnd8Abs = (curBaseSize >= CMP_LENGTH_SHORT)
-                              ? baseEnd - CMP_LENGTH_SHORT
-                              : baseBeg;
+                (curBaseSize >= CmpLength) ? baseEnd - CmpLength : baseBeg;
         }
 
         // If we ran out of room for more 128‑byte compares or one stream ended,
@@ -150,19 +130,20 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
             break;
         }
 
-        // ---- build tiny index over next base chunks (NUMBER_OF_CHUNKS == 16)
+        // ---- build tiny index over next base chunks (NumberOfChunks == 16)
         // ----
         uint64_t loopBaseOffset = baseOffset;
         baseChunks.clear();
 
         {
-            uint64_t n = NUMBER_OF_CHUNKS;
+            uint64_t n = NumberOfChunks;
             while (loopBaseOffset < curBaseSize && n > 0) {
                 uint64_t nextBaseChunkSize =
-                    nextChunk(baseBuf, loopBaseOffset, curBaseSize);
+                    baseCut.next_cut(loopBaseOffset, curBaseSize) -
+                    loopBaseOffset;
                 loopBaseOffset += nextBaseChunkSize;
-                Hash64 fp = XXH3_64bits(baseBuf + loopBaseOffset - hash_length,
-                                        hash_length);
+                Hash64 fp = XXH3_64bits(baseBuf + loopBaseOffset - HashLength,
+                                        HashLength);
                 baseChunks.upsert(fp, loopBaseOffset - 8);
                 --n;
                 _mm_prefetch(
@@ -175,13 +156,14 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
         uint64_t loopOffset = offset;
         uint32_t matchedBaseOffset = baseOffset;
         {
-            uint64_t n = NUMBER_OF_CHUNKS;
+            uint64_t n = NumberOfChunks;
             while (loopOffset < curInputSize && n > 0) {
                 uint64_t nextInputChunkSize =
-                    nextChunk(inputBuf, loopOffset, curInputSize);
+                    inputCut.next_cut(loopOffset, curInputSize) -
+                    loopOffset;
                 loopOffset += nextInputChunkSize;
-                uint64_t fp = XXH3_64bits(inputBuf + loopOffset - hash_length,
-                                          hash_length);
+                uint64_t fp = XXH3_64bits(inputBuf + loopOffset - HashLength,
+                                          HashLength);
 
                 if (baseChunks.find(fp, matchedBaseOffset)) {
                     // align to start of match
@@ -201,37 +183,12 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
 
             const unsigned char* qIn = inBeg + loopOffset;
             const unsigned char* qBase = baseBeg + matchedBaseOffset;
-            // step back by 8B chunks
-            // while (qIn >= lowerIn + CMP_LENGTH_SHORT &&
-            //        qBase >= lowerBase + CMP_LENGTH_SHORT &&
-            //        (*(uint64_t*)qIn ^ *(uint64_t*)qBase) == 0) {
-            //     qIn -= CMP_LENGTH_SHORT;
-            //     qBase -= CMP_LENGTH_SHORT;
-            // }
-            // while (qIn >= lowerIn + CMP_LENGTH_SHORT &&
-            //        qBase >= lowerBase + CMP_LENGTH_SHORT) {
-            //     uint64_t a, b;
-            //     std::memcpy(&a, qIn - CMP_LENGTH_SHORT, CMP_LENGTH_SHORT);
-            //     std::memcpy(&b, qBase - CMP_LENGTH_SHORT, CMP_LENGTH_SHORT);
-            //     if ((a ^ b) != 0) break;
-            //     qIn -= CMP_LENGTH_SHORT;
-            //     qBase -= CMP_LENGTH_SHORT;
-            // }
-
-            while (qIn >= lowerIn + 8 && qBase >= lowerBase + 8) {
-                uint64_t a = load_u64(qIn - 8);
-                uint64_t b = load_u64(qBase - 8);
-                if (a != b) break;
-                qIn -= 8;
-                qBase -= 8;
-            }
-            // step back byte‑by‑byte
-            while (qIn > lowerIn && qBase > baseBeg && qBase > lowerBase) {
-                const unsigned char a = *(qIn - 1);
-                const unsigned char b = *(qBase - 1);
-                if (a != b) break;
-                --qIn;
-                --qBase;
+            {
+                uint64_t back = match_backward(
+                    qIn, qBase,
+                    std::min<uint64_t>(qIn - lowerIn, qBase - lowerBase));
+                qIn -= back;
+                qBase -= back;
             }
             // emit ops for the insertion gap, if any
             if (qIn > lowerIn) {
@@ -259,13 +216,14 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
         // more base chunks
         {
             uint64_t n =
-                NUMBER_OF_CHUNKS * CHUNKS_MULTIPLIER - NUMBER_OF_CHUNKS;
+                NumberOfChunks * CHUNKS_MULTIPLIER - NumberOfChunks;
             while (loopBaseOffset < curBaseSize && n > 0) {
                 uint64_t nextBaseChunkSize =
-                    nextChunk(baseBuf, loopBaseOffset, curBaseSize);
+                    baseCut.next_cut(loopBaseOffset, curBaseSize) -
+                    loopBaseOffset;
                 loopBaseOffset += nextBaseChunkSize;
-                Hash64 fp = XXH3_64bits(baseBuf + loopBaseOffset - hash_length,
-                                        hash_length);
+                Hash64 fp = XXH3_64bits(baseBuf + loopBaseOffset - HashLength,
+                                        HashLength);
                 baseChunks.upsert(fp, loopBaseOffset - 8);
                 --n;
 
@@ -279,16 +237,17 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
 
         // re‑probe input with big chunks
         {
-            uint64_t n = NUMBER_OF_CHUNKS * CHUNKS_MULTIPLIER;
+            uint64_t n = NumberOfChunks * CHUNKS_MULTIPLIER;
             loopOffset = offset;             // reset
             matchedBaseOffset = baseOffset;  // reset
 
             while (loopOffset < curInputSize && n > 0) {
                 uint64_t nextInputChunkSize =
-                    nextChunk(inputBuf, loopOffset, curInputSize);
+                    inputCut.next_cut(loopOffset, curInputSize) -
+                    loopOffset;
                 loopOffset += nextInputChunkSize;
-                uint64_t fp = XXH3_64bits(inputBuf + loopOffset - hash_length,
-                                          hash_length);
+                uint64_t fp = XXH3_64bits(inputBuf + loopOffset - HashLength,
+                                          HashLength);
 
                 if (baseChunks.find(fp, matchedBaseOffset)) {
                     loopOffset -= 8;
@@ -307,30 +266,15 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
             const unsigned char* lowerBase = baseBeg + baseOffset;
 
             if (matchedBaseOffset != baseOffset) {
-                // backtrace with larger steps first (128 then 8) to be
-                // symmetrical with big search
+                // backtrace from the match to the first differing byte
                 const unsigned char* qIn = inBeg + loopOffset;
                 const unsigned char* qBase = baseBeg + matchedBaseOffset;
-
-                while (qIn >= lowerIn + CMP_LENGTH &&
-                       qBase >= lowerBase + CMP_LENGTH &&
-                       memeq_128(qIn - CMP_LENGTH, qBase - CMP_LENGTH)) {
-                    qIn -= CMP_LENGTH;
-                    qBase -= CMP_LENGTH;
-                }
-                // while (qIn >= lowerIn + CMP_LENGTH_SHORT &&
-                //        qBase >= lowerBase + CMP_LENGTH_SHORT &&
-                //        (*(uint64_t*)qIn ^ *(uint64_t*)qBase) == 0) {
-                //     qIn -= CMP_LENGTH_SHORT;
-                //     qBase -= CMP_LENGTH_SHORT;
-                // }
-
-                while (qIn >= lowerIn + 8 && qBase >= lowerBase + 8) {
-                    uint64_t a = load_u64(qIn - 8);
-                    uint64_t b = load_u64(qBase - 8);
-                    if (a != b) break;
-                    qIn -= 8;
-                    qBase -= 8;
+                {
+                    uint64_t back = match_backward(
+                        qIn, qBase,
+                        std::min<uint64_t>(qIn - lowerIn, qBase - lowerBase));
+                    qIn -= back;
+                    qBase -= back;
                 }
 
                 if (qIn > lowerIn) {
@@ -405,6 +349,32 @@ uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
     return deltaSize;
 }
 
+// The curated parameter sets; "default" is the one fencode runs.
+const FDeltaVariant fdelta_variants[] = {
+    {"default", fencodeT<128, 128, 5, 2048>},
+    {"h64", fencodeT<64, 64, 5, 2048>},     // shorter fingerprints
+    {"h32", fencodeT<32, 32, 5, 2048>},
+    {"n6", fencodeT<128, 128, 6, 2048>},    // wider tiny index
+    {"max1k", fencodeT<128, 128, 5, 1024>},  // smaller chunks
+    {"max4k", fencodeT<128, 128, 5, 4096>},
+};
+const size_t fdelta_variant_count =
+    sizeof(fdelta_variants) / sizeof(fdelta_variants[0]);
+
+const FDeltaVariant* fdelta_find_variant(const std::string& name) {
+    for (size_t i = 0; i < fdelta_variant_count; ++i) {
+        if (name == fdelta_variants[i].name) return &fdelta_variants[i];
+    }
+    return nullptr;
+}
+
+uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,
+                 unsigned char* baseBuf, uint64_t baseSize,
+                 unsigned char* outputBuf) {
+    return fencodeT<128, 128, 5, 2048>(inputBuf, inputSize, baseBuf,
+                                       baseSize, outputBuf);
+}
+
 uint64_t fdecode(unsigned char* deltaBuf, uint64_t deltaSize,
                  unsigned char* baseBuf, uint64_t baseSize,
                  unsigned char* outputBuf) {
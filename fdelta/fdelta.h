@@ -18,15 +18,16 @@
 
 #include "../src/lz4/lz4.h"
 #include "fdelta_commands.hpp"
+#include "gear.h"
+#include "isa.h"
 #include "xxhash.h"
 
 // #define DEBUG 1
 
-#define hash_length 128
-
 #define COMPRESSION_LEVEL 1
 
-#define NUMBER_OF_CHUNKS 5
+// The fingerprint length, probe length and tiny index size are template
+// parameters of fencode's variants (fdelta.cc).
 #define CHUNKS_MULTIPLIER 5
 
 size_t minChunkSize = 1;
@@ -34,8 +35,6 @@ size_t maxChunkSize = 2048;
 size_t window_size = 256;          // Default window size
 size_t backward_window_size = 16;  // Default window size
 
-constexpr size_t MaxChunks = NUMBER_OF_CHUNKS * CHUNKS_MULTIPLIER;
-
 size_t sizeBaseChunk = 0;
 size_t sizeInputChunk = 0;
 using Hash64 = std::uint64_t;
@@ -54,43 +53,39 @@ inline bool memeq_8(const void* a, const void* b) {
     return (x ^ y) == 0;
 }
 
-inline bool memeq_32(const void* a, const void* b) {
-#if defined(__AVX2__)
-    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
-    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
-    __m256i x = _mm256_xor_si256(va, vb);
-    return _mm256_testz_si256(x, x);
-#else
+inline bool memeq_32_scalar(const void* a, const void* b) {
     const uint64_t* pa = reinterpret_cast<const uint64_t*>(a);
     const uint64_t* pb = reinterpret_cast<const uint64_t*>(b);
     // Unaligned 64-bit loads are okay on x86; if you target other arches, keep
     // memcpy
     return ((pa[0] ^ pb[0]) | (pa[1] ^ pb[1]) | (pa[2] ^ pb[2]) |
             (pa[3] ^ pb[3])) == 0;
-#endif
 }
 
-inline bool memeq_64(const void* a, const void* b) {
-#if defined(__AVX2__)
-    const uint8_t* pa = static_cast<const uint8_t*>(a);
-    const uint8_t* pb = static_cast<const uint8_t*>(b);
-    return memeq_32(pa, pb) && memeq_32(pa + 32, pb + 32);
-#else
+inline bool memeq_64_scalar(const void* a, const void* b) {
     const uint64_t* pa = reinterpret_cast<const uint64_t*>(a);
     const uint64_t* pb = reinterpret_cast<const uint64_t*>(b);
     return ((pa[0] ^ pb[0]) | (pa[1] ^ pb[1]) | (pa[2] ^ pb[2]) |
             (pa[3] ^ pb[3]) | (pa[4] ^ pb[4]) | (pa[5] ^ pb[5]) |
             (pa[6] ^ pb[6]) | (pa[7] ^ pb[7])) == 0;
-#endif
 }
 
-inline bool memeq_128(const void* a, const void* b) {
-#if defined(__AVX512F__)
-    __m512i va0 = _mm512_loadu_si512(a);
-    __m512i vb0 = _mm512_loadu_si512(b);
-    __mmask64 k = _mm512_cmpeq_epi8_mask(va0, vb0);
-    return k == ~__mmask64(0);  // all bytes equal
-#elif defined(__AVX2__)
+// The vector variants are picked per call from delta_isa (isa.h).
+#if defined(DELTA_ISA_X86)
+DELTA_TARGET_AVX2 inline bool memeq_32_avx2(const void* a, const void* b) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    __m256i x = _mm256_xor_si256(va, vb);
+    return _mm256_testz_si256(x, x);
+}
+
+DELTA_TARGET_AVX2 inline bool memeq_64_avx2(const void* a, const void* b) {
+    const uint8_t* pa = static_cast<const uint8_t*>(a);
+    const uint8_t* pb = static_cast<const uint8_t*>(b);
+    return memeq_32_avx2(pa, pb) && memeq_32_avx2(pa + 32, pb + 32);
+}
+
+DELTA_TARGET_AVX2 inline bool memeq_128_avx2(const void* a, const void* b) {
     const uint8_t* pa = static_cast<const uint8_t*>(a);
     const uint8_t* pb = static_cast<const uint8_t*>(b);
     __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa + 0));
@@ -111,11 +106,43 @@ inline bool memeq_128(const void* a, const void* b) {
     __m256i o23 = _mm256_or_si256(x2, x3);
     __m256i o = _mm256_or_si256(o01, o23);
     return _mm256_testz_si256(o, o);
-#else
-    // Scalar fallback
-    return memeq_64(a, b) && memeq_64(static_cast<const uint8_t*>(a) + 64,
-                                      static_cast<const uint8_t*>(b) + 64);
+}
+
+DELTA_TARGET_AVX512 inline bool memeq_128_avx512(const void* a,
+                                                 const void* b) {
+    const uint8_t* pa = static_cast<const uint8_t*>(a);
+    const uint8_t* pb = static_cast<const uint8_t*>(b);
+    __mmask64 k0 = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(pa),
+                                           _mm512_loadu_si512(pb));
+    __mmask64 k1 = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(pa + 64),
+                                           _mm512_loadu_si512(pb + 64));
+    return (k0 | k1) == 0;  // all bytes equal
+}
+#endif
+
+inline bool memeq_32(const void* a, const void* b) {
+#if defined(DELTA_ISA_X86)
+    if (delta_isa >= DELTA_ISA_AVX2) return memeq_32_avx2(a, b);
+#endif
+    return memeq_32_scalar(a, b);
+}
+
+inline bool memeq_64(const void* a, const void* b) {
+#if defined(DELTA_ISA_X86)
+    if (delta_isa >= DELTA_ISA_AVX2) return memeq_64_avx2(a, b);
 #endif
+    return memeq_64_scalar(a, b);
+}
+
+inline bool memeq_128(const void* a, const void* b) {
+#if defined(DELTA_ISA_X86)
+    if (delta_isa >= DELTA_ISA_AVX512) return memeq_128_avx512(a, b);
+    if (delta_isa >= DELTA_ISA_AVX2) return memeq_128_avx2(a, b);
+#endif
+    // Scalar fallback
+    return memeq_64_scalar(a, b) &&
+           memeq_64_scalar(static_cast<const uint8_t*>(a) + 64,
+                           static_cast<const uint8_t*>(b) + 64);
 }
 
 struct alignas(64) TinyMapSIMD {
@@ -382,23 +409,14 @@ uint32_t g[256] = {
     0xbf8b296d, 0xf1a57003, 0xa8057fb6, 0x2ce2e565, 0x56d7a64a, 0xa6e30007,
     0xe0562996, 0xabec18bd, 0x6b8c68ed, 0x0b1c1af1};
 
-size_t nextChunk(unsigned char* readBuffer, size_t buffBegin, size_t buffEnd) {
-    uint64_t i = 1;
-    uint32_t hash = 0;
-    size_t size = buffEnd - buffBegin;
-    if (size > maxChunkSize) size = maxChunkSize;
-    for (; i + 1 < size; i += 2) {
-        uint8_t byte = *(uint8_t*)(readBuffer + buffBegin + i);
-        uint8_t byte2 = *(uint8_t*)(readBuffer + buffBegin + i + 1);
-        hash = (hash << 2) + (g[byte]) + (g[byte2]);
-        // hash = (hash << 1) + (g[byte]);
-        if (!(hash & 0x18035100)) {
-        // if (!(hash & 0x1804110)) {
-            return i;
-        }
-    }
+// Two bytes per step from buffBegin + 1, cut where (hash & 0x18035100) == 0;
+// see gear.h.
+extern const GearParams fdelta_gear = {g, 0x18035100, 2, 2, 1,
+                                       static_cast<uint32_t>(maxChunkSize)};
 
-    return size;
+size_t nextChunk(unsigned char* readBuffer, size_t buffBegin, size_t buffEnd) {
+    GearCutter cut(fdelta_gear, readBuffer);
+    return cut.next_cut(buffBegin, buffEnd) - buffBegin;
 }
 
 size_t nextChunkBackward(unsigned char* readBuffer, size_t buffBegin,
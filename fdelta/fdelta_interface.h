@@ -1,8 +1,32 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
+#include "gear.h"
+
+// inputBuf and baseBuf stay readable for MISMATCH_OVERREAD bytes past their
+// ends (mismatch.h), as DeltaEncoder's buffers do.
 uint64_t fencode(unsigned char* inputBuf, uint64_t inputSize,unsigned char* baseBuf,
                  uint64_t baseSize, unsigned char* outputBuf);
 
 uint64_t fdecode(unsigned char* deltaBuf, uint64_t deltaSize,unsigned char* baseBuf,
-                uint64_t baseSize, unsigned char* outputBuf);
\ No newline at end of file
+                uint64_t baseSize, unsigned char* outputBuf);
+
+// Chunk boundaries of fencode
+extern const GearParams fdelta_gear;
+
+// fencode compiled for other settings of its constants, picked by name at
+// run time; each has the contract of fencode, and fdecode reads all of them.
+struct FDeltaVariant {
+    const char* name;
+    uint64_t (*encode)(unsigned char* inputBuf, uint64_t inputSize,
+                       unsigned char* baseBuf, uint64_t baseSize,
+                       unsigned char* outputBuf);
+};
+
+extern const FDeltaVariant fdelta_variants[];
+extern const size_t fdelta_variant_count;
+
+// nullptr if no variant has that name
+const FDeltaVariant* fdelta_find_variant(const std::string& name);
@@ -0,0 +1,115 @@
+#include "gear.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "isa.h"
+
+const char* gear_path_name(GearPath path) {
+    switch (path) {
+    case GEAR_AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+/* the CPU runs it and --isa (delta_isa) allows it; GearPath takes the
+ * values of the delta_isa levels */
+bool gear_has_path(GearPath path) {
+#if defined(DELTA_ISA_X86)
+    return static_cast<int>(path) <= delta_isa;
+#else
+    return path == GEAR_SCALAR;
+#endif
+}
+
+GearCutter::GearCutter(const GearParams& params, const uint8_t* buf)
+    : p_(params), buf_(buf) {}
+
+#if defined(DELTA_ISA_X86)
+template <int Off>
+DELTA_TARGET_AVX512 static inline __m512i back8x64(__m512i cur, __m512i prev) {
+    if constexpr (Off == 8)
+        return prev;
+    else
+        return _mm512_alignr_epi64(cur, prev, 8 - Off);
+}
+
+template <int L, int l = 0>
+DELTA_TARGET_AVX512 static inline __m512i double8x64(__m512i h, __m512i* prev, uint32_t shift) {
+    if constexpr (l == L) {
+        return h;
+    } else {
+        __m512i back = back8x64<(1 << l)>(h, prev[l]);
+        prev[l] = h;
+        h = _mm512_add_epi64(
+            h, _mm512_sll_epi64(back, _mm_cvtsi32_si128(shift << l)));
+        return double8x64<L, l + 1>(h, prev, shift);
+    }
+}
+
+template <int L>
+DELTA_TARGET_AVX512 static void rolling64_avx512(const GearWindow64& p, const uint8_t* data,
+                             size_t from, size_t to, uint64_t* out) {
+    __m512i prev[L];
+    for (auto& r : prev) r = _mm512_setzero_si512();
+    for (size_t e = from >= 8 ? from - 8 : 0; e < to; e += 8) {
+        uint64_t word = 0;
+        if (e + 8 <= to)
+            memcpy(&word, data + e, 8);
+        else
+            memcpy(&word, data + e, to - e);
+        __m512i h = _mm512_i32gather_epi64(
+            _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(word))),
+            reinterpret_cast<const long long*>(p.table), 8);
+        h = double8x64<L>(h, prev, p.shift);
+        if (e >= from && e + 8 <= to) {
+            _mm512_storeu_si512(out + (e - from), h);
+        } else {
+            alignas(64) uint64_t tmp[8];
+            _mm512_store_si512(tmp, h);
+            for (size_t j = 0; j < 8; j++)
+                if (e + j >= from && e + j < to) out[e + j - from] = tmp[j];
+        }
+    }
+}
+#endif
+
+/* four 64-bit lanes (AVX2) did not beat the serial loop, eight do */
+GearPath gear_best_path64() {
+    return gear_has_path(GEAR_AVX512) ? GEAR_AVX512 : GEAR_SCALAR;
+}
+
+void gear_rolling64(const GearWindow64& params, const uint8_t* data,
+                    size_t from, size_t to, uint64_t* out) {
+    gear_rolling64(params, data, from, to, out, gear_best_path64());
+}
+
+/* the doubling needs 64 / shift steps, 2, 4 or 8 */
+void gear_rolling64(const GearWindow64& params, const uint8_t* data,
+                    size_t from, size_t to, uint64_t* out, GearPath path) {
+    if (from >= to) return;
+    if (!gear_has_path(path)) path = GEAR_SCALAR;
+    const uint32_t steps = 64 / params.shift;
+#if defined(DELTA_ISA_X86)
+    if (path == GEAR_AVX512) {
+        switch (steps) {
+        case 8:
+            return rolling64_avx512<3>(params, data, from, to, out);
+        case 4:
+            return rolling64_avx512<2>(params, data, from, to, out);
+        case 2:
+            return rolling64_avx512<1>(params, data, from, to, out);
+        }
+    }
+#endif
+    (void)path;
+    size_t e = from >= steps - 1 ? from - (steps - 1) : 0;
+    uint64_t fp = 0;
+    for (; e < to; e++) {
+        fp = (fp << params.shift) + params.table[data[e]];
+        if (e >= from) out[e - from] = fp;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+// Gear rolling hash and content-defined boundaries shared by the chunk
+// encoders (fdelta, Gdelta, EDelta, DDelta).
+//
+// Each encoder rolls fp = (fp << shift) + v, v being table[byte], or
+// table[a] + table[b] when the hash takes two bytes per step, and cuts
+// where (fp & mask) == 0. The cut scan is the serial loop: at about a
+// cycle per byte it stayed ahead of 8- and 16-lane versions with every
+// encoder's parameters, the encoders restarting their scans too often for
+// a block of rolling values to pay off (gear_bench). Gdelta's 64-bit
+// rolling values, taken at every position, are the one place eight lanes
+// win, so gear_rolling64 has an AVX-512 path.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+struct GearParams {
+    const uint32_t* table;
+    uint32_t mask;     // cut where (fp & mask) == 0
+    uint32_t shift;    // a power of two
+    uint32_t stride;   // bytes per step, 1 or 2
+    uint32_t min_len;  // bytes skipped before the hash starts rolling
+    uint32_t max_len;  // forced cut this far from the start
+};
+
+// Values of the delta_isa levels (isa.h), so that gear_has_path compares
+// them directly. 1 (AVX2) has no path: its rolling64 measured slower than
+// the scalar loop and was removed.
+enum GearPath {
+    GEAR_SCALAR = 0,
+    GEAR_AVX512 = 2,  // 8 positions of 64 bits
+};
+
+const char* gear_path_name(GearPath path);
+
+// Whether the CPU runs the path and delta_isa (isa.h) allows it.
+bool gear_has_path(GearPath path);
+
+// Cuts one buffer into strings.
+class GearCutter {
+public:
+    GearCutter(const GearParams& params, const uint8_t* buf);
+
+    // For the string starting at start: the hash rolls from
+    // start + min_len, and the result is the first byte of the first step
+    // that hits, if the whole step lies below
+    // bound = min(end, start + max_len); else bound. end is at most the
+    // buffer size.
+    size_t next_cut(size_t start, size_t end);
+
+private:
+    size_t scan_serial(size_t first, size_t bound) const;
+
+    GearParams p_;
+    const uint8_t* buf_;
+};
+
+// The serial loop is inline so that the encoders keep it in their own
+// loops. With the shift a constant, shift and add fold into one lea, which
+// halves the latency of a step.
+template <uint32_t Stride, uint32_t Shift>
+inline size_t gear_scan_serial(const uint32_t* table, uint32_t shift,
+                               uint32_t mask, const uint8_t* buf,
+                               size_t first, size_t bound) {
+    if (Shift != 0) shift = Shift;
+    uint32_t fp = 0;
+    for (size_t e = first; e < bound; e += Stride) {
+        uint32_t v = table[buf[e]];
+        if (Stride == 2) v += table[buf[e - 1]];
+        fp = (fp << shift) + v;
+        if (!(fp & mask)) return e - (Stride - 1);
+    }
+    return bound;
+}
+
+inline size_t GearCutter::scan_serial(size_t first, size_t bound) const {
+    const uint32_t* t = p_.table;
+    if (p_.stride == 1) {
+        return p_.shift == 1
+                   ? gear_scan_serial<1, 1>(t, 1, p_.mask, buf_, first, bound)
+                   : gear_scan_serial<1, 0>(t, p_.shift, p_.mask, buf_,
+                                            first, bound);
+    }
+    return p_.shift == 2
+               ? gear_scan_serial<2, 2>(t, 2, p_.mask, buf_, first, bound)
+               : gear_scan_serial<2, 0>(t, p_.shift, p_.mask, buf_, first,
+                                        bound);
+}
+
+inline size_t GearCutter::next_cut(size_t start, size_t end) {
+    const size_t bound = std::min(end, start + p_.max_len);
+    const size_t o = start + p_.min_len;
+    if (o + p_.stride > bound) return bound;
+    return scan_serial(o + p_.stride - 1, bound);
+}
+
+// Gdelta samples every position rather than cutting, so it only needs
+// the rolling value: out[i] is the fingerprint of the window ending at
+// data[from + i], for from + i < to. Bytes from to on are not read. shift
+// is 8, 16 or 32; the window is 64 / shift bytes.
+struct GearWindow64 {
+    const uint64_t* table;
+    uint32_t shift;
+};
+
+void gear_rolling64(const GearWindow64& params, const uint8_t* data,
+                    size_t from, size_t to, uint64_t* out);
+void gear_rolling64(const GearWindow64& params, const uint8_t* data,
+                    size_t from, size_t to, uint64_t* out, GearPath path);
+
+// GEAR_AVX512 when gear_has_path allows it, else GEAR_SCALAR
+GearPath gear_best_path64();
@@ -0,0 +1,179 @@
+#include "hugemem.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HUGEMEM_PAGE ((size_t)2 << 20)
+#define HUGEMEM_HEAD 64 /* keeps the payload 64-byte aligned */
+#define HUGEMEM_POOL 16
+
+enum { KIND_SMALL, KIND_THP, KIND_HUGETLB };
+
+typedef struct {
+    size_t map_len;  /* whole mapping, 0 when malloc'd */
+    size_t capacity; /* payload bytes */
+    int kind;
+} hugemem_head;
+
+typedef struct {
+    void* base;
+    size_t map_len;
+    int kind;
+} hugemem_region;
+
+static int mode = HUGEMEM_OFF;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static hugemem_region pool[HUGEMEM_POOL];
+static int pool_count;
+static hugemem_stats_t stats;
+
+int hugemem_set_mode(const char* name) {
+    if (strcmp(name, "off") == 0)
+        mode = HUGEMEM_OFF;
+    else if (strcmp(name, "thp") == 0)
+        mode = HUGEMEM_THP;
+    else if (strcmp(name, "hugetlb") == 0)
+        mode = HUGEMEM_HUGETLB;
+    else
+        return 0;
+    return 1;
+}
+
+int hugemem_mode(void) { return mode; }
+
+const char* hugemem_mode_name(int m) {
+    switch (m) {
+    case HUGEMEM_THP:
+        return "thp";
+    case HUGEMEM_HUGETLB:
+        return "hugetlb";
+    default:
+        return "off";
+    }
+}
+
+/* 2 MB aligned mapping of len bytes, len a multiple of HUGEMEM_PAGE */
+static void* map_thp(size_t len) {
+    size_t over = len + HUGEMEM_PAGE;
+    uint8_t* raw = (uint8_t*)mmap(NULL, over, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    uint8_t* base =
+        (uint8_t*)(((uintptr_t)raw + HUGEMEM_PAGE - 1) & ~(HUGEMEM_PAGE - 1));
+    if (base > raw) munmap(raw, (size_t)(base - raw));
+    if (raw + over > base + len)
+        munmap(base + len, (size_t)(raw + over - (base + len)));
+#if defined(MADV_HUGEPAGE)
+    madvise(base, len, MADV_HUGEPAGE);
+#endif
+    return base;
+}
+
+static void* map_region(size_t len, int* kind) {
+#if defined(MAP_HUGETLB)
+    if (mode == HUGEMEM_HUGETLB) {
+        void* p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *kind = KIND_HUGETLB;
+            return p;
+        }
+    }
+#endif
+    *kind = KIND_THP;
+    return map_thp(len);
+}
+
+/* smallest pooled region that fits without wasting more than half */
+static void* take_pooled(size_t len, size_t* map_len, int* kind) {
+    void* base = NULL;
+    pthread_mutex_lock(&pool_lock);
+    int best = -1;
+    for (int i = 0; i < pool_count; i++) {
+        if (pool[i].map_len >= len && pool[i].map_len <= 2 * len &&
+            (best < 0 || pool[i].map_len < pool[best].map_len))
+            best = i;
+    }
+    if (best >= 0) {
+        base = pool[best].base;
+        *map_len = pool[best].map_len;
+        *kind = pool[best].kind;
+        pool[best] = pool[--pool_count];
+        stats.reused++;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return base;
+}
+
+void* hugemem_alloc(size_t size) {
+    hugemem_head* head;
+    if (mode == HUGEMEM_OFF || size < HUGEMEM_MIN_SIZE) {
+        void* raw;
+        if (posix_memalign(&raw, HUGEMEM_HEAD, HUGEMEM_HEAD + size) != 0)
+            return NULL;
+        head = (hugemem_head*)raw;
+        head->map_len = 0;
+        head->capacity = size;
+        head->kind = KIND_SMALL;
+        __atomic_fetch_add(&stats.small, 1, __ATOMIC_RELAXED);
+        return (uint8_t*)raw + HUGEMEM_HEAD;
+    }
+    size_t len = (HUGEMEM_HEAD + size + HUGEMEM_PAGE - 1) & ~(HUGEMEM_PAGE - 1);
+    size_t map_len = len;
+    int kind;
+    void* base = take_pooled(len, &map_len, &kind);
+    if (base == NULL) {
+        base = map_region(len, &kind);
+        if (base == NULL) return NULL;
+        pthread_mutex_lock(&pool_lock);
+        if (kind == KIND_HUGETLB)
+            stats.hugetlb++;
+        else
+            stats.thp++;
+        pthread_mutex_unlock(&pool_lock);
+    }
+    head = (hugemem_head*)base;
+    head->map_len = map_len;
+    head->capacity = map_len - HUGEMEM_HEAD;
+    head->kind = kind;
+    return (uint8_t*)base + HUGEMEM_HEAD;
+}
+
+void hugemem_free(void* p) {
+    if (p == NULL) return;
+    hugemem_head* head = (hugemem_head*)((uint8_t*)p - HUGEMEM_HEAD);
+    if (head->map_len == 0) {
+        free(head);
+        return;
+    }
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count < HUGEMEM_POOL) {
+        pool[pool_count].base = head;
+        pool[pool_count].map_len = head->map_len;
+        pool[pool_count].kind = head->kind;
+        pool_count++;
+        head = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    if (head != NULL) munmap(head, head->map_len);
+}
+
+void* hugemem_realloc(void* p, size_t size) {
+    if (p == NULL) return hugemem_alloc(size);
+    hugemem_head* head = (hugemem_head*)((uint8_t*)p - HUGEMEM_HEAD);
+    if (size <= head->capacity) return p;
+    void* q = hugemem_alloc(size);
+    if (q == NULL) return NULL;
+    memcpy(q, p, head->capacity);
+    hugemem_free(p);
+    return q;
+}
+
+void hugemem_get_stats(hugemem_stats_t* out) {
+    pthread_mutex_lock(&pool_lock);
+    *out = stats;
+    out->small = __atomic_load_n(&stats.small, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&pool_lock);
+}
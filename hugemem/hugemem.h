@@ -0,0 +1,61 @@
+#ifndef HUGEMEM_H
+#define HUGEMEM_H
+/* Scratch regions that can be backed by huge pages: Gdelta's streams and
+ * hash table, xdelta3's arena and source index.
+ *
+ * With the mode at "off" hugemem_alloc() is an aligned malloc. Otherwise
+ * regions of HUGEMEM_MIN_SIZE bytes or more are mapped on their own,
+ * rounded up to 2 MB pages:
+ *  - "hugetlb" maps them with MAP_HUGETLB from the reserved pool
+ *    (vm.nr_hugepages), and falls back to "thp" when the pool is empty;
+ *  - "thp" maps normal pages on a 2 MB boundary and asks for transparent
+ *    huge pages with madvise(MADV_HUGEPAGE), which the kernel may or may
+ *    not grant.
+ * Freed regions go to a small pool and serve the next allocations of
+ * their size, so an encoder that allocates per chunk keeps the same pages
+ * instead of faulting (and zeroing) fresh huge pages every time.
+ *
+ * Every pointer is 64-byte aligned and is released with hugemem_free(),
+ * not free(). Contents are undefined, as with malloc. Thread-safe. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HUGEMEM_MIN_SIZE (1u << 20)
+
+typedef enum {
+    HUGEMEM_OFF = 0,
+    HUGEMEM_THP = 1,
+    HUGEMEM_HUGETLB = 2,
+} hugemem_mode_t;
+
+/* "off", "thp" or "hugetlb"; returns 0 for an unknown name. Regions
+ * already mapped keep their backing. Default "off". */
+int hugemem_set_mode(const char* name);
+int hugemem_mode(void);
+const char* hugemem_mode_name(int mode);
+
+void* hugemem_alloc(size_t size);
+void* hugemem_realloc(void* p, size_t size);
+void hugemem_free(void* p);
+
+/* regions mapped so far, by backing, and allocations served from the
+ * pool */
+typedef struct {
+    uint64_t hugetlb;
+    uint64_t thp;
+    uint64_t small;
+    uint64_t reused;
+} hugemem_stats_t;
+
+void hugemem_get_stats(hugemem_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HUGEMEM_H */
@@ -0,0 +1,49 @@
+#include "isa.h"
+
+#include <string.h>
+
+int delta_isa = DELTA_ISA_SCALAR;
+
+delta_isa_t delta_isa_detect(void) {
+#if defined(DELTA_ISA_X86)
+    /* also checks that the OS saves the wider registers (xgetbv) */
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw"))
+        return DELTA_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2")) return DELTA_ISA_AVX2;
+#endif
+    return DELTA_ISA_SCALAR;
+}
+
+__attribute__((constructor)) static void delta_isa_init(void) {
+    delta_isa = delta_isa_detect();
+}
+
+int delta_isa_set(const char* name) {
+    int isa;
+    if (strcmp(name, "auto") == 0)
+        isa = delta_isa_detect();
+    else if (strcmp(name, "scalar") == 0)
+        isa = DELTA_ISA_SCALAR;
+    else if (strcmp(name, "avx2") == 0)
+        isa = DELTA_ISA_AVX2;
+    else if (strcmp(name, "avx512") == 0)
+        isa = DELTA_ISA_AVX512;
+    else
+        return 0;
+    if (isa > (int)delta_isa_detect()) return 0;
+    delta_isa = isa;
+    return 1;
+}
+
+const char* delta_isa_name(int isa) {
+    switch (isa) {
+    case DELTA_ISA_AVX2:
+        return "avx2";
+    case DELTA_ISA_AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
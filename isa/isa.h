@@ -0,0 +1,45 @@
+#ifndef DELTA_ISA_H
+#define DELTA_ISA_H
+/* Instruction sets of the hot kernels: the mismatch finders, memeq, the
+ * Gear boundaries and rolling fingerprints, and zdelta's match compare.
+ *
+ * The tree is built for a baseline x86-64 (DELTA_MARCH in CMakeLists.txt).
+ * Each kernel carries AVX2 and AVX-512 variants compiled with the target
+ * attributes below and picks one per call from delta_isa. delta_isa starts
+ * at the best level the CPU and the OS support, read with cpuid before
+ * main(); delta_isa_set() lowers it, e.g. for the --isa option of the
+ * tools. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    DELTA_ISA_SCALAR = 0, /* baseline build, 8-byte words */
+    DELTA_ISA_AVX2 = 1,
+    DELTA_ISA_AVX512 = 2, /* AVX-512 F and BW */
+} delta_isa_t;
+
+/* level the kernels use */
+extern int delta_isa;
+
+/* best level this CPU runs */
+delta_isa_t delta_isa_detect(void);
+
+/* "scalar", "avx2", "avx512" or "auto". Returns 0 when the name is unknown
+ * or the CPU lacks the level, leaving delta_isa as it was. */
+int delta_isa_set(const char* name);
+
+const char* delta_isa_name(int isa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DELTA_ISA_X86 1
+#define DELTA_TARGET_AVX2 __attribute__((target("avx2")))
+#define DELTA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
+
+#endif /* DELTA_ISA_H */
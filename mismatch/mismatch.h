@@ -0,0 +1,191 @@
+#pragma once
+// Mismatch finders shared by the chunk encoders (fdelta, Gdelta, EDelta,
+// DDelta).
+//
+// match_forward() returns how many leading bytes of a and b are equal and
+// match_backward() how many bytes are equal going back from a_end and
+// b_end, both at most n. They compare 64 (AVX-512) or 32 (AVX2) bytes per
+// step and take the exact mismatch byte from the compare mask with a bit
+// scan, so the result is a byte count, not a multiple of the step. No byte
+// outside the n compared is read: the AVX-512 tail uses a masked load and
+// the others drop to 8 bytes, then 1. The vector variants are compiled
+// with target attributes and chosen per call from delta_isa (isa.h), so
+// they cost a call where they used to be inlined.
+//
+// match_forward_padded() gives the same result for buffers that stay
+// readable for MISMATCH_OVERREAD bytes past a + n and b + n, as the
+// DeltaEncoder buffers do (src/encoders/encoder.h). Every step, the last
+// included, loads a full vector and the result is clipped to n, which saves
+// the tail on the short matches that dominate the encoders' loops.
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "isa.h"
+
+#define MISMATCH_OVERREAD 64
+
+static inline uint64_t mismatch_load_u64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline size_t match_forward_scalar(const uint8_t* a, const uint8_t* b,
+                                          size_t i, size_t n) {
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x = mismatch_load_u64(a + i) ^ mismatch_load_u64(b + i);
+        if (x != 0) return i + (__builtin_ctzll(x) >> 3);
+    }
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+static inline size_t match_backward_scalar(const uint8_t* a_end,
+                                           const uint8_t* b_end, size_t i,
+                                           size_t n) {
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x = mismatch_load_u64(a_end - i - 8) ^
+                     mismatch_load_u64(b_end - i - 8);
+        if (x != 0) return i + (__builtin_clzll(x) >> 3);
+    }
+    while (i < n && a_end[-1 - static_cast<ptrdiff_t>(i)] ==
+                        b_end[-1 - static_cast<ptrdiff_t>(i)]) {
+        ++i;
+    }
+    return i;
+}
+
+static inline size_t match_forward_padded_scalar(const uint8_t* a,
+                                                 const uint8_t* b, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        uint64_t x = mismatch_load_u64(a + i) ^ mismatch_load_u64(b + i);
+        if (x != 0) return std::min(i + (__builtin_ctzll(x) >> 3), n);
+    }
+    return n;
+}
+
+#if defined(DELTA_ISA_X86)
+DELTA_TARGET_AVX512 static inline size_t match_forward_avx512(
+    const uint8_t* a, const uint8_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __mmask64 ne = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a + i),
+                                               _mm512_loadu_si512(b + i));
+        if (ne != 0) return i + __builtin_ctzll(ne);
+    }
+    if (i < n) {
+        __mmask64 live = (1ULL << (n - i)) - 1;
+        __mmask64 ne = _mm512_mask_cmpneq_epi8_mask(
+            live, _mm512_maskz_loadu_epi8(live, a + i),
+            _mm512_maskz_loadu_epi8(live, b + i));
+        return ne != 0 ? i + __builtin_ctzll(ne) : n;
+    }
+    return n;
+}
+
+DELTA_TARGET_AVX2 static inline size_t match_forward_avx2(const uint8_t* a,
+                                                          const uint8_t* b,
+                                                          size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        uint32_t ne = ~static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+        if (ne != 0) return i + __builtin_ctz(ne);
+    }
+    return match_forward_scalar(a, b, i, n);
+}
+
+DELTA_TARGET_AVX512 static inline size_t match_backward_avx512(
+    const uint8_t* a_end, const uint8_t* b_end, size_t n) {
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __mmask64 ne =
+            _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a_end - i - 64),
+                                    _mm512_loadu_si512(b_end - i - 64));
+        if (ne != 0) return i + __builtin_clzll(ne);
+    }
+    if (i < n) {
+        // The r bytes left start at a_end - n; the last one is bit r - 1.
+        size_t r = n - i;
+        __mmask64 live = (1ULL << r) - 1;
+        __mmask64 ne = _mm512_mask_cmpneq_epi8_mask(
+            live, _mm512_maskz_loadu_epi8(live, a_end - n),
+            _mm512_maskz_loadu_epi8(live, b_end - n));
+        return ne != 0 ? i + r - 64 + __builtin_clzll(ne) : n;
+    }
+    return n;
+}
+
+DELTA_TARGET_AVX2 static inline size_t match_backward_avx2(
+    const uint8_t* a_end, const uint8_t* b_end, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(a_end - i - 32));
+        __m256i vb = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(b_end - i - 32));
+        uint32_t ne = ~static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+        if (ne != 0) return i + __builtin_clz(ne);
+    }
+    return match_backward_scalar(a_end, b_end, i, n);
+}
+
+DELTA_TARGET_AVX512 static inline size_t match_forward_padded_avx512(
+    const uint8_t* a, const uint8_t* b, size_t n) {
+    for (size_t i = 0; i < n; i += 64) {
+        __mmask64 ne = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a + i),
+                                               _mm512_loadu_si512(b + i));
+        if (ne != 0) return std::min<size_t>(i + __builtin_ctzll(ne), n);
+    }
+    return n;
+}
+
+DELTA_TARGET_AVX2 static inline size_t match_forward_padded_avx2(
+    const uint8_t* a, const uint8_t* b, size_t n) {
+    for (size_t i = 0; i < n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        uint32_t ne = ~static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+        if (ne != 0) return std::min<size_t>(i + __builtin_ctz(ne), n);
+    }
+    return n;
+}
+#endif
+
+static inline size_t match_forward(const uint8_t* a, const uint8_t* b,
+                                   size_t n) {
+#if defined(DELTA_ISA_X86)
+    if (delta_isa >= DELTA_ISA_AVX512) return match_forward_avx512(a, b, n);
+    if (delta_isa >= DELTA_ISA_AVX2) return match_forward_avx2(a, b, n);
+#endif
+    return match_forward_scalar(a, b, 0, n);
+}
+
+static inline size_t match_backward(const uint8_t* a_end, const uint8_t* b_end,
+                                    size_t n) {
+#if defined(DELTA_ISA_X86)
+    if (delta_isa >= DELTA_ISA_AVX512)
+        return match_backward_avx512(a_end, b_end, n);
+    if (delta_isa >= DELTA_ISA_AVX2) return match_backward_avx2(a_end, b_end, n);
+#endif
+    return match_backward_scalar(a_end, b_end, 0, n);
+}
+
+static inline size_t match_forward_padded(const uint8_t* a, const uint8_t* b,
+                                          size_t n) {
+#if defined(DELTA_ISA_X86)
+    if (delta_isa >= DELTA_ISA_AVX512)
+        return match_forward_padded_avx512(a, b, n);
+    if (delta_isa >= DELTA_ISA_AVX2) return match_forward_padded_avx2(a, b, n);
+#endif
+    return match_forward_padded_scalar(a, b, n);
+}
@@ -0,0 +1,145 @@
+#include "alloc_stats.h"
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+namespace {
+
+std::atomic<bool> enabled{false};
+std::atomic<uint64_t> allocs{0};
+std::atomic<uint64_t> bytes{0};
+std::atomic<int64_t> live{0};
+std::atomic<int64_t> peak{0};
+
+inline void record(void* p) {
+    if (!enabled.load(std::memory_order_relaxed) || p == nullptr) return;
+    int64_t size = static_cast<int64_t>(malloc_usable_size(p));
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+    int64_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t top = peak.load(std::memory_order_relaxed);
+    while (now > top &&
+           !peak.compare_exchange_weak(top, now, std::memory_order_relaxed)) {
+    }
+}
+
+inline void unrecord(void* p) {
+    if (!enabled.load(std::memory_order_relaxed) || p == nullptr) return;
+    live.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)),
+                   std::memory_order_relaxed);
+}
+
+}  // namespace
+
+#if defined(DELTA_ALLOC_STATS)
+// glibc's allocator under its internal names
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t align, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size) {
+    void* p = __libc_malloc(size);
+    record(p);
+    return p;
+}
+
+void* calloc(size_t n, size_t size) {
+    void* p = __libc_calloc(n, size);
+    record(p);
+    return p;
+}
+
+void* realloc(void* old, size_t size) {
+    unrecord(old);
+    void* p = __libc_realloc(old, size);
+    // a failed realloc leaves the old block in place
+    record(p != nullptr || size == 0 ? p : old);
+    return p;
+}
+
+void* reallocarray(void* old, size_t n, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(n, size, &total)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return realloc(old, total);
+}
+
+void free(void* p) {
+    unrecord(p);
+    __libc_free(p);
+}
+
+void* memalign(size_t align, size_t size) {
+    void* p = __libc_memalign(align, size);
+    record(p);
+    return p;
+}
+
+void* aligned_alloc(size_t align, size_t size) {
+    return memalign(align, size);
+}
+
+int posix_memalign(void** out, size_t align, size_t size) {
+    if (align < sizeof(void*) || (align & (align - 1)) != 0) return EINVAL;
+    void* p = __libc_memalign(align, size);
+    if (p == nullptr) return ENOMEM;
+    record(p);
+    *out = p;
+    return 0;
+}
+
+void* valloc(size_t size) {
+    void* p = __libc_valloc(size);
+    record(p);
+    return p;
+}
+
+void* pvalloc(size_t size) {
+    void* p = __libc_pvalloc(size);
+    record(p);
+    return p;
+}
+}
+
+bool alloc_stats_enable() {
+    enabled.store(true);
+    return true;
+}
+#else
+bool alloc_stats_enable() { return false; }
+#endif
+
+AllocMark alloc_stats_begin() {
+    AllocMark mark;
+    mark.allocs = allocs.load();
+    mark.bytes = bytes.load();
+    mark.live = live.load();
+    peak.store(mark.live);
+    return mark;
+}
+
+AllocCall alloc_stats_end(const AllocMark& mark) {
+    AllocCall call;
+    call.allocs = allocs.load() - mark.allocs;
+    call.bytes = bytes.load() - mark.bytes;
+    int64_t top = peak.load() - mark.live;
+    call.peak = top > 0 ? static_cast<uint64_t>(top) : 0;
+    return call;
+}
+
+uint64_t peak_rss_kb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return static_cast<uint64_t>(usage.ru_maxrss);
+}
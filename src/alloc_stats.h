@@ -0,0 +1,36 @@
+#pragma once
+// Heap accounting for delta_compress (--alloc-stats).
+//
+// alloc_stats.cc replaces malloc, free and the rest of the family in the
+// executable when built with DELTA_ALLOC_STATS. operator new allocates
+// through malloc, so the encoders' C and C++ allocations, libstdc++'s
+// included, all pass through it. It only counts while enabled; otherwise
+// each call costs a branch. Bytes are malloc_usable_size() bytes, the
+// size free() can see. Memory mapped directly (hugemem regions) is not
+// counted; peak RSS covers it.
+
+#include <cstdint>
+
+struct AllocMark {
+    uint64_t allocs;
+    uint64_t bytes;
+    int64_t live;
+};
+
+// Allocations, bytes and the highest live bytes above the start, over one
+// measured call.
+struct AllocCall {
+    uint64_t allocs;
+    uint64_t bytes;
+    uint64_t peak;
+};
+
+// False when the interposer is not built in.
+bool alloc_stats_enable();
+
+// Opens a measured call: the peak restarts from the live bytes now.
+AllocMark alloc_stats_begin();
+AllocCall alloc_stats_end(const AllocMark& mark);
+
+// Peak resident set of the process, from getrusage, in KB.
+uint64_t peak_rss_kb();
@@ -0,0 +1,485 @@
+// Writes a synthetic dataset that delta_compress and the other tools read
+// like a real one: <out>/<dataset>/chunks/<hash> files and
+// <out>/<dataset>/meta/delta_map.csv listing base/target pairs.
+//
+// Every base is drawn from the content model, then each of its targets is
+// made from it by one edit model:
+//   insert     new bytes inserted at random places
+//   delete     random ranges removed
+//   move       blocks cut and put back elsewhere
+//   flip       single bytes changed
+//   zero       ranges overwritten with zeros
+//   shift      ranges moved a few bytes (1..63) off their place
+//   mixed      any of the above, edit by edit
+//   unrelated  a fresh chunk with nothing of the base
+// The similarity drawn for the pair sets how many base bytes the edits
+// touch: (1 - similarity) * base size, split into 1..--edits edits. The
+// map's estimated_similarity is the share of target bytes still taken
+// from the base, counted while editing; an extra last column names the
+// model. Chunks are named by their XXH3 128-bit hash.
+//
+// Pair i only depends on the seed, i and the options, so a dataset, or any
+// one pair of it, comes back byte for byte.
+//
+//   delta_datagen -o <dir> -d <dataset> [options]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xxhash.h"
+
+namespace fs = std::filesystem;
+
+// splitmix64
+struct Rng {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    // uniform in [0, n), n > 0
+    uint64_t below(uint64_t n) { return next() % n; }
+    // uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    double normal() {
+        double u = std::max(uniform(), 1e-300);
+        return std::sqrt(-2.0 * std::log(u)) *
+               std::cos(6.283185307179586 * uniform());
+    }
+};
+
+// fixed:X, uniform:LO:HI or lognormal:MEDIAN:SIGMA
+struct Dist {
+    enum Kind { FIXED, UNIFORM, LOGNORMAL } kind = FIXED;
+    double a = 0.0;
+    double b = 0.0;
+
+    double sample(Rng& rng) const {
+        switch (kind) {
+            case UNIFORM:
+                return a + (b - a) * rng.uniform();
+            case LOGNORMAL:
+                return a * std::exp(b * rng.normal());
+            default:
+                return a;
+        }
+    }
+};
+
+static bool parseDist(const std::string& text, Dist* dist) {
+    std::vector<std::string> parts;
+    std::stringstream in(text);
+    std::string part;
+    while (std::getline(in, part, ':')) parts.push_back(part);
+    char* end = nullptr;
+    std::vector<double> values;
+    for (size_t i = 1; i < parts.size(); ++i) {
+        values.push_back(std::strtod(parts[i].c_str(), &end));
+        if (end == parts[i].c_str() || *end != '\0') return false;
+    }
+    if (parts.size() == 2 && parts[0] == "fixed") {
+        *dist = {Dist::FIXED, values[0], values[0]};
+    } else if (parts.size() == 3 && parts[0] == "uniform" &&
+               values[0] <= values[1]) {
+        *dist = {Dist::UNIFORM, values[0], values[1]};
+    } else if (parts.size() == 3 && parts[0] == "lognormal" &&
+               values[0] > 0) {
+        *dist = {Dist::LOGNORMAL, values[0], values[1]};
+    } else {
+        return false;
+    }
+    return true;
+}
+
+enum Model { INSERT, DELETE, MOVE, FLIP, ZERO, SHIFT, MIXED, UNRELATED };
+
+static const char* const kModelNames[] = {
+    "insert", "delete", "move", "flip", "zero", "shift", "mixed", "unrelated"};
+static const int kModels = sizeof(kModelNames) / sizeof(kModelNames[0]);
+
+struct GenOptions {
+    fs::path out_dir;
+    std::string dataset;
+    uint64_t pairs = 1000;
+    uint64_t seed = 1;
+    uint32_t targets_per_base = 1;
+    Dist size{Dist::UNIFORM, 4096, 65536};
+    Dist similarity{Dist::UNIFORM, 0.5, 0.99};
+    uint32_t max_edits = 8;
+    uint64_t max_size = 64 * 1024;  // MAX_CHUNK_SIZE of the encoders
+    std::string content = "text";
+    int entropy = 8;                 // bits per byte of "random" content
+    double weights[kModels] = {1, 1, 1, 1, 1, 1, 1, 0};
+};
+
+static bool parseModels(const std::string& text, double* weights) {
+    std::fill(weights, weights + kModels, 0.0);
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        double weight = 1.0;
+        if (colon != std::string::npos) {
+            weight = std::strtod(item.c_str() + colon + 1, nullptr);
+        }
+        int m = 0;
+        while (m < kModels && name != kModelNames[m]) ++m;
+        if (m == kModels || weight < 0) return false;
+        weights[m] = weight;
+    }
+    double total = 0;
+    for (int m = 0; m < kModels; ++m) total += weights[m];
+    return total > 0;
+}
+
+static Model pickModel(Rng& rng, const double* weights, int count) {
+    double total = 0;
+    for (int m = 0; m < count; ++m) total += weights[m];
+    double x = rng.uniform() * total;
+    for (int m = 0; m < count; ++m) {
+        if (x < weights[m]) return static_cast<Model>(m);
+        x -= weights[m];
+    }
+    return static_cast<Model>(count - 1);
+}
+
+// Content of new bytes: "text" strings words of a fixed vocabulary, like
+// source code; "random" draws bytes of `entropy` bits
+class Content {
+public:
+    explicit Content(const GenOptions& options)
+        : text_(options.content == "text"), entropy_(options.entropy) {
+        Rng rng(0x5eed);
+        static const char kLetters[] = "abcdefghijklmnopqrstuvwxyz _\n{}();";
+        for (int w = 0; w < 500; ++w) {
+            std::string word(2 + rng.below(11), ' ');
+            for (char& c : word) c = kLetters[rng.below(sizeof(kLetters) - 1)];
+            words_.push_back(word);
+        }
+    }
+
+    void append(Rng& rng, size_t n, std::vector<uint8_t>* out) const {
+        size_t end = out->size() + n;
+        if (!text_) {
+            const uint8_t mask = static_cast<uint8_t>((1u << entropy_) - 1);
+            while (out->size() < end) {
+                out->push_back(static_cast<uint8_t>(rng.next()) & mask);
+            }
+            return;
+        }
+        while (out->size() < end) {
+            const std::string& w = words_[rng.below(words_.size())];
+            out->insert(out->end(), w.begin(), w.end());
+        }
+        out->resize(end);
+    }
+
+private:
+    bool text_;
+    int entropy_;
+    std::vector<std::string> words_;
+};
+
+// A target under construction: its bytes and whether each came from the
+// base
+struct Target {
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> from_base;
+
+    size_t size() const { return bytes.size(); }
+
+    void insert(size_t pos, const std::vector<uint8_t>& data, uint8_t origin) {
+        bytes.insert(bytes.begin() + pos, data.begin(), data.end());
+        from_base.insert(from_base.begin() + pos, data.size(), origin);
+    }
+    void erase(size_t pos, size_t len) {
+        bytes.erase(bytes.begin() + pos, bytes.begin() + pos + len);
+        from_base.erase(from_base.begin() + pos,
+                        from_base.begin() + pos + len);
+    }
+};
+
+static void applyEdit(Model model, size_t len, Rng& rng,
+                      const Content& content, Target* t) {
+    std::vector<uint8_t> fresh;
+    if (model == INSERT) {
+        content.append(rng, len, &fresh);
+        t->insert(rng.below(t->size() + 1), fresh, 0);
+        return;
+    }
+    if (t->size() < 2) return;
+    len = std::min(len, t->size() - 1);
+    size_t pos = rng.below(t->size() - len + 1);
+    switch (model) {
+        case DELETE:
+            t->erase(pos, len);
+            break;
+        case MOVE: {
+            std::vector<uint8_t> block(t->bytes.begin() + pos,
+                                       t->bytes.begin() + pos + len);
+            std::vector<uint8_t> origin(t->from_base.begin() + pos,
+                                        t->from_base.begin() + pos + len);
+            t->erase(pos, len);
+            size_t to = rng.below(t->size() + 1);
+            t->bytes.insert(t->bytes.begin() + to, block.begin(),
+                            block.end());
+            t->from_base.insert(t->from_base.begin() + to, origin.begin(),
+                                origin.end());
+            break;
+        }
+        case FLIP:
+            for (size_t i = 0; i < len; ++i) {
+                size_t p = rng.below(t->size());
+                t->bytes[p] ^= static_cast<uint8_t>(1 + rng.below(255));
+                t->from_base[p] = 0;
+            }
+            break;
+        case ZERO:
+            std::fill(t->bytes.begin() + pos, t->bytes.begin() + pos + len, 0);
+            std::fill(t->from_base.begin() + pos,
+                      t->from_base.begin() + pos + len, 0);
+            break;
+        case SHIFT: {
+            // the range moves right by d: d new bytes in front of it, its
+            // last d bytes dropped
+            if (len < 2) break;
+            size_t d = 1 + rng.below(std::min<size_t>(63, len - 1));
+            t->erase(pos + len - d, d);
+            content.append(rng, d, &fresh);
+            t->insert(pos, fresh, 0);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void makeTarget(const GenOptions& options, const Content& content,
+                       const std::vector<uint8_t>& base, Model model,
+                       double similarity, Rng& rng, Target* t) {
+    t->bytes.clear();
+    t->from_base.clear();
+    if (model == UNRELATED) {
+        size_t n = static_cast<size_t>(std::max(1.0, options.size.sample(rng)));
+        content.append(rng, std::min<uint64_t>(n, options.max_size),
+                       &t->bytes);
+        t->from_base.assign(t->bytes.size(), 0);
+    } else {
+        t->bytes = base;
+        t->from_base.assign(base.size(), 1);
+        size_t budget = static_cast<size_t>(
+            std::llround((1.0 - similarity) * static_cast<double>(base.size())));
+        size_t edits = 1 + rng.below(options.max_edits);
+        for (size_t e = 0; e < edits && budget > 0; ++e) {
+            size_t len = std::max<size_t>(1, budget / (edits - e));
+            budget -= std::min(len, budget);
+            Model m = model == MIXED ? static_cast<Model>(rng.below(MIXED))
+                                     : model;
+            applyEdit(m, len, rng, content, t);
+        }
+    }
+    if (t->size() > options.max_size) {
+        t->bytes.resize(options.max_size);
+        t->from_base.resize(options.max_size);
+    }
+    if (t->size() == 0) {  // the encoders take no empty input
+        content.append(rng, 1, &t->bytes);
+        t->from_base.push_back(0);
+    }
+}
+
+static std::string chunkName(const std::vector<uint8_t>& bytes) {
+    XXH128_hash_t h = XXH3_128bits(bytes.data(), bytes.size());
+    char name[33];
+    snprintf(name, sizeof(name), "%016llx%016llx",
+             static_cast<unsigned long long>(h.high64),
+             static_cast<unsigned long long>(h.low64));
+    return name;
+}
+
+static bool writeChunk(const fs::path& dir, const std::string& name,
+                       const std::vector<uint8_t>& bytes) {
+    fs::path path = dir / name;
+    if (fs::exists(path)) return true;  // same hash, same bytes
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+    if (!out) {
+        std::cerr << "Failed to write chunk: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " -o <dir> -d <dataset> [options]\n\n"
+        << "Options:\n"
+        << "  -o, --out <dir>             Dataset root, as delta_compress -p\n"
+        << "  -d, --dataset <name>        Dataset name\n"
+        << "  -n, --pairs <count>         Base/target pairs (default: 1000)\n"
+        << "  -s, --seed <n>              Random seed (default: 1)\n"
+        << "  -b, --targets-per-base <n>  Targets edited from each base "
+           "(default: 1)\n"
+        << "  -z, --size <dist>           Base size in bytes (default: "
+           "uniform:4096:65536)\n"
+        << "  -S, --similarity <dist>     Share of base bytes the edits keep "
+           "(default:\n"
+        << "                              uniform:0.5:0.99)\n"
+        << "  -m, --models <list>         Edit models, name[:weight],... "
+           "(default: insert,\n"
+        << "                              delete,move,flip,zero,shift,mixed)\n"
+        << "  -e, --edits <count>         Most edits per target (default: 8)\n"
+        << "  -c, --content <kind>        text or random[:bits] (default: "
+           "text)\n"
+        << "  -M, --max-size <bytes>      Largest chunk (default: 65536)\n"
+        << "  -h, --help                  Show this help\n\n"
+        << "A <dist> is fixed:X, uniform:LO:HI or lognormal:MEDIAN:SIGMA.\n"
+        << "Models: insert delete move flip zero shift mixed unrelated\n";
+}
+
+static bool parseArgs(int argc, char* argv[], GenOptions* options,
+                      bool* show_help) {
+    *show_help = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            *show_help = true;
+            return true;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "-o" || arg == "--out") {
+            options->out_dir = value;
+        } else if (arg == "-d" || arg == "--dataset") {
+            options->dataset = value;
+        } else if (arg == "-n" || arg == "--pairs") {
+            options->pairs = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "-s" || arg == "--seed") {
+            options->seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "-b" || arg == "--targets-per-base") {
+            options->targets_per_base =
+                std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "-z" || arg == "--size") {
+            ok = parseDist(value, &options->size);
+        } else if (arg == "-S" || arg == "--similarity") {
+            ok = parseDist(value, &options->similarity);
+        } else if (arg == "-m" || arg == "--models") {
+            ok = parseModels(value, options->weights);
+        } else if (arg == "-e" || arg == "--edits") {
+            options->max_edits = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "-c" || arg == "--content") {
+            options->content = value.substr(0, value.find(':'));
+            if (options->content == "random" &&
+                value.find(':') != std::string::npos) {
+                options->entropy = std::atoi(value.c_str() + 7);
+            }
+            ok = (options->content == "text" ||
+                  options->content == "random") &&
+                 options->entropy >= 0 && options->entropy <= 8;
+        } else if (arg == "-M" || arg == "--max-size") {
+            options->max_size =
+                std::max<uint64_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+        if (!ok) {
+            std::cerr << "Bad value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+    if (options->out_dir.empty() || options->dataset.empty()) {
+        std::cerr << "Both --out and --dataset are required\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    GenOptions options;
+    bool show_help = false;
+    if (!parseArgs(argc, argv, &options, &show_help)) {
+        return 1;
+    }
+    if (show_help) {
+        return 0;
+    }
+
+    fs::path root = options.out_dir / options.dataset;
+    fs::path chunk_dir = root / "chunks";
+    fs::path meta_dir = root / "meta";
+    std::error_code ec;
+    fs::create_directories(chunk_dir, ec);
+    fs::create_directories(meta_dir, ec);
+    std::ofstream map(meta_dir / "delta_map.csv");
+    if (!map) {
+        std::cerr << "Failed to create " << meta_dir / "delta_map.csv"
+                  << "\n";
+        return 1;
+    }
+    map << "delta_id,original_hash,base_hash,base_size,original_size,"
+           "delta_size,base_level,estimated_similarity,model\n";
+
+    Content content(options);
+    std::vector<uint8_t> base;
+    std::string base_name;
+    Target target;
+    uint64_t counts[kModels] = {};
+    for (uint64_t i = 0; i < options.pairs; ++i) {
+        if (i % options.targets_per_base == 0) {
+            Rng rng(options.seed * 0x9e3779b97f4a7c15ull ^ (i << 1));
+            size_t n = static_cast<size_t>(std::min<double>(
+                std::max(1.0, options.size.sample(rng)),
+                static_cast<double>(options.max_size)));
+            base.clear();
+            content.append(rng, n, &base);
+            base_name = chunkName(base);
+            if (!writeChunk(chunk_dir, base_name, base)) return 1;
+        }
+        Rng rng(options.seed * 0x9e3779b97f4a7c15ull ^ (i << 1 | 1));
+        Model model = pickModel(rng, options.weights, kModels);
+        double similarity =
+            std::min(1.0, std::max(0.0, options.similarity.sample(rng)));
+        makeTarget(options, content, base, model, similarity, rng, &target);
+        std::string target_name = chunkName(target.bytes);
+        if (!writeChunk(chunk_dir, target_name, target.bytes)) return 1;
+
+        uint64_t kept = std::count(target.from_base.begin(),
+                                   target.from_base.end(), 1);
+        map << i << "," << target_name << "," << base_name << ","
+            << base.size() << "," << target.size() << ",0,1," << std::fixed
+            << std::setprecision(4)
+            << static_cast<double>(kept) / target.size() << ","
+            << kModelNames[model] << "\n";
+        counts[model]++;
+    }
+
+    std::cout << "Wrote " << options.pairs << " pairs to " << root << "\n";
+    for (int m = 0; m < kModels; ++m) {
+        if (counts[m]) std::cout << "  " << kModelNames[m] << ": " << counts[m]
+                                 << "\n";
+    }
+    return map ? 0 : 1;
+}
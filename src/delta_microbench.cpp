@@ -0,0 +1,530 @@
+// Measures the hot kernels of the chunk encoders one at a time, on
+// synthetic buffers of several sizes and byte entropies.
+//
+// Each case runs a few untimed warmup passes first. The number of passes
+// per repetition is then raised until one repetition lasts --min-time, and
+// --reps repetitions are timed. The report gives the mean time of one
+// operation, the 95% confidence interval of that mean over the
+// repetitions, and the throughput over the bytes the kernel reads (or
+// writes, for the varint writers). The op column says what an operation is
+// for the kernel:
+//   compare  one memeq_* call
+//   chunk    one cut by nextChunk/nextChunkBackward
+//   string   one string cut by EDelta's rolling_gear_v3
+//   window   one find_maximum_sse128 over window_size bytes
+//   scan     one range_scan_geq_sse128 call
+//   hash     one XXH3 of a fingerprint window (fencode's HashLength)
+//   base     indexing the whole buffer as a Gdelta base
+//   value    one varint or record field
+// The data column is the entropy in bits per byte (h0 to h8), or, for the
+// varints, the bit width of the values (v7 to v28).
+//
+//   delta_microbench [options]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "edelta_varint.h"
+#include "fdelta.h"
+#include "gdelta.h"
+#include "gdelta_stream.h"
+#include "isa.h"
+#include "util.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Settings {
+    std::vector<size_t> sizes = {256, 4096, 65536};
+    int reps = 10;
+    int warmup = 3;
+    double min_time = 0.002;  // seconds per repetition
+    std::string filter;
+};
+
+// What one pass over the input covered
+struct Work {
+    uint64_t ops;
+    uint64_t bytes;
+};
+
+struct Result {
+    double ns;    // mean per operation
+    double ci95;  // half width of the 95% interval of the mean
+    double gbps;
+};
+
+static volatile uint64_t sink;
+
+static const size_t kMaxSize = size_t(1) << 30;
+
+// Two-sided 95% quantiles of Student's t for 1..30 degrees of freedom
+static const double kT95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+static double t95(int df) {
+    if (df < 1) return 0.0;
+    return df <= 30 ? kT95[df - 1] : 1.960;
+}
+
+// The barrier takes each pass's result and clobbers memory, so that the
+// compiler neither drops a pass nor hoists it out of the loop.
+template <typename Pass>
+static double timePasses(Pass& pass, uint64_t passes) {
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < passes; ++i) {
+        Work work = pass();
+        asm volatile("" : : "r"(work.ops) : "memory");
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Pass>
+static Result measure(const Settings& set, Pass&& pass) {
+    Work work = pass();
+    for (int i = 1; i < set.warmup; ++i) pass();
+
+    uint64_t passes = 1;
+    for (;;) {
+        double seconds = timePasses(pass, passes);
+        if (seconds >= set.min_time || passes >= (1u << 30)) break;
+        uint64_t scaled =
+            seconds > 0 ? static_cast<uint64_t>(passes * set.min_time /
+                                                seconds * 1.2)
+                        : passes * 16;
+        passes = std::max(passes * 2, scaled);
+    }
+
+    std::vector<double> ns(set.reps);
+    for (int r = 0; r < set.reps; ++r) {
+        ns[r] = timePasses(pass, passes) * 1e9 /
+                static_cast<double>(passes * std::max<uint64_t>(work.ops, 1));
+    }
+    double mean = 0.0;
+    for (double v : ns) mean += v;
+    mean /= set.reps;
+    double var = 0.0;
+    for (double v : ns) var += (v - mean) * (v - mean);
+    var = set.reps > 1 ? var / (set.reps - 1) : 0.0;
+
+    Result res;
+    res.ns = mean;
+    res.ci95 = t95(set.reps - 1) * std::sqrt(var / set.reps);
+    res.gbps = work.ops ? static_cast<double>(work.bytes) /
+                              (mean * static_cast<double>(work.ops))
+                        : 0.0;
+    return res;
+}
+
+static void report(const char* kernel, const char* op, size_t size,
+                   const std::string& data, const Result& res) {
+    std::cout << kernel << "," << op << "," << size << "," << data << ","
+              << std::fixed << std::setprecision(2) << res.ns << ","
+              << res.ci95 << "," << std::setprecision(3) << res.gbps << "\n";
+}
+
+// Buffers of the kernels: 64-byte aligned and padded, like DeltaEncoder's
+struct Buffer {
+    uint8_t* data = nullptr;
+
+    explicit Buffer(size_t size) {
+        if (posix_memalign(reinterpret_cast<void**>(&data), 64, size + 64) !=
+            0) {
+            throw std::bad_alloc();
+        }
+        memset(data, 0, size + 64);
+    }
+    ~Buffer() { free(data); }
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+};
+
+static uint64_t nextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Bytes with `bits` bits of entropy each: uniform over 2^bits values
+static void fillEntropy(uint8_t* buf, size_t size, int bits, uint64_t seed) {
+    uint64_t state = seed;
+    const uint8_t mask = static_cast<uint8_t>((1u << bits) - 1);
+    for (size_t i = 0; i < size; ++i) {
+        buf[i] = static_cast<uint8_t>(nextRandom(state)) & mask;
+    }
+}
+
+static bool selected(const Settings& set, const char* kernel) {
+    return set.filter.empty() ||
+           std::string(kernel).find(set.filter) != std::string::npos;
+}
+
+// The compare is a template argument, so that the loop inlines it as the
+// encoders do (the dispatching ones, at least: a vector variant cannot be
+// inlined into code built without its target)
+template <bool (*Memeq)(const void*, const void*), size_t Width>
+static Work compareAll(const uint8_t* a, const uint8_t* b, size_t size) {
+    uint64_t acc = 0, ops = 0;
+    for (size_t i = 0; i + Width <= size; i += Width, ++ops) {
+        acc += Memeq(a + i, b + i);
+    }
+    sink = acc;
+    return {ops, ops * Width};
+}
+
+struct MemeqKernel {
+    const char* name;
+    Work (*run)(const uint8_t* a, const uint8_t* b, size_t size);
+    size_t width;
+    int isa;  // lowest delta_isa that runs it
+};
+
+static const MemeqKernel kMemeq[] = {
+    {"memeq_8", compareAll<memeq_8, 8>, 8, DELTA_ISA_SCALAR},
+    {"memeq_32", compareAll<memeq_32, 32>, 32, DELTA_ISA_SCALAR},
+    {"memeq_64", compareAll<memeq_64, 64>, 64, DELTA_ISA_SCALAR},
+    {"memeq_128", compareAll<memeq_128, 128>, 128, DELTA_ISA_SCALAR},
+    {"memeq_32_scalar", compareAll<memeq_32_scalar, 32>, 32,
+     DELTA_ISA_SCALAR},
+    {"memeq_64_scalar", compareAll<memeq_64_scalar, 64>, 64,
+     DELTA_ISA_SCALAR},
+#if defined(DELTA_ISA_X86)
+    {"memeq_32_avx2", compareAll<memeq_32_avx2, 32>, 32, DELTA_ISA_AVX2},
+    {"memeq_64_avx2", compareAll<memeq_64_avx2, 64>, 64, DELTA_ISA_AVX2},
+    {"memeq_128_avx2", compareAll<memeq_128_avx2, 128>, 128,
+     DELTA_ISA_AVX2},
+    {"memeq_128_avx512", compareAll<memeq_128_avx512, 128>, 128,
+     DELTA_ISA_AVX512},
+#endif
+};
+
+template <size_t HashLength>
+static Work hashWindows(const uint8_t* buf, size_t size) {
+    uint64_t acc = 0, ops = 0;
+    for (size_t i = 0; i + HashLength <= size; i += HashLength, ++ops) {
+        acc ^= XXH3_64bits(buf + i, HashLength);
+    }
+    sink = acc;
+    return {ops, ops * HashLength};
+}
+
+// The kernels that read a buffer of bytes
+static void benchBytes(const Settings& set, size_t size, int bits) {
+    Buffer a(size), b(size);
+    fillEntropy(a.data, size, bits, 0x9e3779b97f4a7c15ull + size);
+    memcpy(b.data, a.data, size);
+    uint8_t* buf = a.data;
+    const std::string data = "h" + std::to_string(bits);
+
+    for (const MemeqKernel& k : kMemeq) {
+        if (!selected(set, k.name) || delta_isa < k.isa || size < k.width) {
+            continue;
+        }
+        Result res =
+            measure(set, [&]() { return k.run(a.data, b.data, size); });
+        report(k.name, "compare", size, data, res);
+    }
+
+    if (selected(set, "nextChunk")) {
+        Result res = measure(set, [&]() -> Work {
+            uint64_t ops = 0;
+            for (size_t pos = 0; pos < size; ++ops) {
+                pos += std::max<size_t>(nextChunk(buf, pos, size), 1);
+            }
+            return {ops, size};
+        });
+        report("nextChunk", "chunk", size, data, res);
+    }
+    if (selected(set, "nextChunkBackward")) {
+        Result res = measure(set, [&]() -> Work {
+            uint64_t ops = 0;
+            for (size_t end = size; end > 0; ++ops) {
+                end -= std::min<size_t>(
+                    std::max<size_t>(nextChunkBackward(buf, 0, end), 1), end);
+            }
+            return {ops, size};
+        });
+        report("nextChunkBackward", "chunk", size, data, res);
+    }
+
+#ifdef __SSE3__
+    if (selected(set, "find_maximum_sse128") && size >= window_size) {
+        Result res = measure(set, [&]() -> Work {
+            uint64_t acc = 0, ops = 0;
+            for (size_t i = 0; i + window_size <= size;
+                 i += window_size, ++ops) {
+                acc += find_maximum_sse128(buf, i, i + window_size,
+                                           sse_array);
+            }
+            sink = acc;
+            return {ops, ops * window_size};
+        });
+        report("find_maximum_sse128", "window", size, data, res);
+    }
+    if (selected(set, "range_scan_geq_sse128")) {
+        // 0xff only occurs at 8 bits of entropy; below, one call scans all
+        Result res = measure(set, [&]() -> Work {
+            uint64_t ops = 0;
+            for (size_t pos = 0; pos + SSE_REGISTER_SIZE_BYTES <= size;
+                 ++ops) {
+                pos = range_scan_geq_sse128(buf, pos, size, 0xff) + 1;
+            }
+            return {ops, size};
+        });
+        report("range_scan_geq_sse128", "scan", size, data, res);
+    }
+#endif
+
+    // fencode's HashLength: 128 by default, 64 and 32 in its variants
+    if (selected(set, "xxh3_128")) {
+        report("xxh3_128", "hash", size, data, measure(set, [&]() {
+                   return hashWindows<128>(buf, size);
+               }));
+    }
+    if (selected(set, "xxh3_64")) {
+        report("xxh3_64", "hash", size, data, measure(set, [&]() {
+                   return hashWindows<64>(buf, size);
+               }));
+    }
+    if (selected(set, "xxh3_32")) {
+        report("xxh3_32", "hash", size, data, measure(set, [&]() {
+                   return hashWindows<32>(buf, size);
+               }));
+    }
+
+    // Gdelta's base index (GSampledChunking), once per distinct variant
+    int bits_of_size = 0;
+    for (size_t tmp = size + 10; tmp; tmp >>= 1) bits_of_size++;
+    std::vector<uint32_t> table(size_t(1) << bits_of_size);
+    for (size_t v = 0; v < gdelta_variant_count; ++v) {
+        const GDeltaVariant& gv = gdelta_variants[v];
+        bool seen = false;
+        for (size_t u = 0; u < v; ++u) {
+            seen |= gdelta_variants[u].index == gv.index;
+        }
+        std::string name = std::string("gdelta_index_") + gv.name;
+        if (seen || !selected(set, name.c_str())) continue;
+        Result res = measure(set, [&]() -> Work {
+            gv.index(buf, static_cast<uint32_t>(size), table.data(),
+                     bits_of_size);
+            return {1, size};
+        });
+        report(name.c_str(), "base", size, data, res);
+    }
+
+    if (selected(set, "rolling_gear_v3")) {
+        // EDelta cuts BASE_BEGIN (5) strings per call
+        const int strings = 5;
+        int cut[strings + 1];
+        Result res = measure(set, [&]() -> Work {
+            GearCutter cutter(edelta_gear, buf);
+            uint64_t ops = 0;
+            for (size_t pos = 0; pos < size;) {
+                int n = rolling_gear_v3(cutter, static_cast<int>(pos),
+                                        static_cast<int>(size - pos),
+                                        strings, cut);
+                for (int i = 0; i < strings; ++i) {
+                    ops += cut[i + 1] > cut[i];
+                }
+                pos += std::max(n, 1);
+            }
+            return {ops, size};
+        });
+        report("rolling_gear_v3", "string", size, data, res);
+    }
+}
+
+// Each encoder's varint writer and reader over size / 4 values of `bits`
+// bits, all of them taking bits / 7 bytes
+static void benchVarints(const Settings& set, size_t size, int bits) {
+    const size_t count = std::max<size_t>(size / 4, 1);
+    std::vector<uint32_t> values(count);
+    uint64_t state = 0x243f6a8885a308d3ull + bits;
+    const uint32_t low = 1u << (bits - 7);
+    for (uint32_t& v : values) {
+        v = low + static_cast<uint32_t>(nextRandom(state) % (low * 127));
+    }
+    const size_t cap = count * 5;
+    Buffer out(cap);
+    const std::string data = "v" + std::to_string(bits);
+    uint64_t written = 0;
+
+    if (selected(set, "fdelta_varint")) {
+        report("fdelta_varint_write", "value", size, data,
+               measure(set, [&]() -> Work {
+                   deltaPtr = out.data;
+                   for (uint32_t v : values) writeVarint(v);
+                   written = deltaPtr - out.data;
+                   return {count, written};
+               }));
+        report("fdelta_varint_read", "value", size, data,
+               measure(set, [&]() -> Work {
+                   const unsigned char* p = out.data;
+                   const unsigned char* end = out.data + written;
+                   uint64_t acc = 0;
+                   while (p < end) acc += readVarint(p, end);
+                   sink = acc;
+                   return {count, written};
+               }));
+    }
+
+    if (selected(set, "gdelta_varint")) {
+        BufferStreamDescriptor stream = {out.data, 0, cap, false};
+        report("gdelta_varint_write", "value", size, data,
+               measure(set, [&]() -> Work {
+                   stream.cursor = 0;
+                   for (uint32_t v : values) write_varint(stream, v);
+                   written = stream.cursor;
+                   return {count, written};
+               }));
+        report("gdelta_varint_read", "value", size, data,
+               measure(set, [&]() -> Work {
+                   stream.cursor = 0;
+                   uint64_t acc = 0;
+                   while (stream.cursor < written) acc += read_varint(stream);
+                   sink = acc;
+                   return {count, written};
+               }));
+    }
+
+    if (selected(set, "edelta_varint")) {
+        report("edelta_varint_write", "value", size, data,
+               measure(set, [&]() -> Work {
+                   uint32_t n = 0;
+                   for (uint32_t v : values) n += put_varint(out.data + n, v);
+                   written = n;
+                   return {count, written};
+               }));
+        report("edelta_varint_read", "value", size, data,
+               measure(set, [&]() -> Work {
+                   const uint8_t* p = out.data;
+                   const uint8_t* end = out.data + written;
+                   uint64_t acc = 0;
+                   while (p < end) acc += get_varint(&p, end);
+                   sink = acc;
+                   return {count, written};
+               }));
+    }
+
+    // EDelta's records carry fields sized by a control byte instead
+    if (selected(set, "edelta_field")) {
+        report("edelta_field_write", "value", size, data,
+               measure(set, [&]() -> Work {
+                   uint32_t n = 0;
+                   for (uint32_t v : values) {
+                       uint32_t fb = field_bytes(v);
+                       out.data[n++] = static_cast<uint8_t>(fb - 1);
+                       put_field(out.data + n, v, fb);
+                       n += fb;
+                   }
+                   written = n;
+                   return {count, written};
+               }));
+        report("edelta_field_read", "value", size, data,
+               measure(set, [&]() -> Work {
+                   const uint8_t* p = out.data;
+                   const uint8_t* end = out.data + written;
+                   uint64_t acc = 0;
+                   while (p < end) {
+                       uint32_t fb = *p + 1u;
+                       acc += get_field(p + 1, fb);
+                       p += 1 + fb;
+                   }
+                   sink = acc;
+                   return {count, written};
+               }));
+    }
+}
+
+static bool parseSizes(const std::string& list, std::vector<size_t>* sizes) {
+    sizes->clear();
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        size_t size = std::strtoull(item.c_str(), nullptr, 10);
+        if (size == 0 || size > kMaxSize) return false;
+        sizes->push_back(size);
+    }
+    return !sizes->empty();
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " [options]\n\n"
+        << "Options:\n"
+        << "  -s, --sizes <list>          Buffer sizes in bytes, comma "
+           "separated\n"
+        << "                              (default: 256,4096,65536)\n"
+        << "  -r, --reps <count>          Timed repetitions per case "
+           "(default: 10)\n"
+        << "  -w, --warmup <count>        Untimed passes first (default: 3)\n"
+        << "  -t, --min-time <ms>         Least time of one repetition "
+           "(default: 2)\n"
+        << "  -k, --kernel <text>         Only kernels whose name contains "
+           "text\n"
+        << "  -i, --isa <name>            Kernel instruction set: auto|scalar|"
+           "avx2|avx512\n"
+        << "  -h, --help                  Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    Settings set;
+    std::string isa = "auto";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "-s" || arg == "--sizes") {
+            if (!parseSizes(value, &set.sizes)) {
+                std::cerr << "Bad size list: " << value << "\n";
+                return 1;
+            }
+        } else if (arg == "-r" || arg == "--reps") {
+            set.reps = std::max(2, std::atoi(value.c_str()));
+        } else if (arg == "-w" || arg == "--warmup") {
+            set.warmup = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "-t" || arg == "--min-time") {
+            set.min_time = std::max(0.01, std::atof(value.c_str())) / 1e3;
+        } else if (arg == "-k" || arg == "--kernel") {
+            set.filter = value;
+        } else if (arg == "-i" || arg == "--isa") {
+            isa = value;
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!delta_isa_set(isa.c_str())) {
+        std::cerr << "Unknown or unsupported instruction set: " << isa
+                  << "\n";
+        return 1;
+    }
+
+    std::cerr << "isa " << delta_isa_name(delta_isa) << ", " << set.reps
+              << " reps of >= " << set.min_time * 1e3 << " ms, "
+              << set.warmup << " warmup passes\n";
+    std::cout << "kernel,op,size,data,ns_per_op,ci95_ns,gbps\n";
+    for (size_t size : set.sizes) {
+        for (int bits : {0, 2, 4, 8}) benchBytes(set, size, bits);
+        for (int bits : {7, 14, 21, 28}) benchVarints(set, size, bits);
+    }
+    return 0;
+}
@@ -1,11 +1,16 @@
 #include "ddelta_encoder.h"
 
 uint64_t DDeltaEncoder::encode() {
-    DDeltaEncode(inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
+    static_assert(DELTA_OUTPUT_CAPACITY >= MAX_CHUNK_SIZE + DDELTA_MAX_OVERHEAD,
+                  "outputBuf must hold any DDelta delta");
+    outputSize = DELTA_OUTPUT_CAPACITY;
+    if (DDeltaEncode(inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
             static_cast<uint32_t>(baseSize), outputBuf,
-            &outputSize);
-    std::cout << "inputSize: " << inputSize << ", baseSize: " << baseSize
-              << ", outputSize: " << outputSize << "\n";
+            &outputSize) < 0) {
+        std::cerr << "DDeltaEncoder::encode() failed\n";
+        outputSize = 0;
+        return 0;
+    }
     return outputSize;
 }
 
@@ -4,8 +4,6 @@ uint64_t EDeltaEncoder::encode() {
     EDeltaEncode(inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
             static_cast<uint32_t>(baseSize), outputBuf,
             &outputSize);
-    std::cout << "inputSize: " << inputSize << ", baseSize: " << baseSize
-              << ", outputSize: " << outputSize << "\n";
     return outputSize;
 }
 
@@ -5,31 +5,72 @@
 #include <iostream>
 
 #include <fstream>
+#include <cstdlib>
 #include <cstring>
+#include <new>
+
+#include "mismatch.h"
 
 #define MAX_CHUNK_SIZE (64 * 1024)  // 64MB 
 
+// inputBuf, baseBuf and outputBuf start on a DELTA_BUFFER_ALIGN boundary and
+// stay readable for DELTA_BUFFER_PAD bytes past MAX_CHUNK_SIZE, hence past
+// the end of any chunk loaded into them. The encoders count on it for
+// full-vector tails (match_forward_padded); the padding is zeroed once and
+// never part of a result.
+#define DELTA_BUFFER_ALIGN 64
+#define DELTA_BUFFER_PAD 64
+static_assert(DELTA_BUFFER_PAD >= MISMATCH_OVERREAD,
+              "padding must cover the kernels' overread");
+
+// outputBuf holds either a decoded chunk or a delta, and a delta of an
+// unmatched chunk is the chunk plus the encoder's headers (DDelta: 17
+// bytes, ddelta.h). It has this many bytes before its padding.
+#define DELTA_OUTPUT_CAPACITY (MAX_CHUNK_SIZE + 64)
+
 class DeltaEncoder {
 public:
-    virtual ~DeltaEncoder() = default;
+    virtual ~DeltaEncoder() {
+        free(inputBuf);
+        free(outputBuf);
+        free(baseBuf);
+    }
 
-    alignas(64) uint8_t* inputBuf;
+    uint8_t* inputBuf;
     uint64_t inputSize;
 
-    alignas(64) uint8_t* outputBuf;
+    uint8_t* outputBuf;
     uint64_t outputSize;
 
-    alignas(64) uint8_t* baseBuf;
+    uint8_t* baseBuf;
     uint64_t baseSize;
     
     DeltaEncoder() : inputBuf(nullptr), inputSize(0), outputBuf(nullptr), outputSize(0), baseBuf(nullptr), baseSize(0) {
-        inputBuf = new uint8_t[MAX_CHUNK_SIZE];
-        outputBuf = new uint8_t[MAX_CHUNK_SIZE];
-        baseBuf = new uint8_t[MAX_CHUNK_SIZE];
+        inputBuf = allocBuffer();
+        outputBuf = allocBuffer(DELTA_OUTPUT_CAPACITY);
+        baseBuf = allocBuffer();
         std::cout << "DeltaEncoder initialized.\n";
     }
+    // size bytes (MAX_CHUNK_SIZE by default) under the contract above;
+    // released with free() (Gdelta may grow outputBuf with realloc).
+    static uint8_t* allocBuffer(size_t size = MAX_CHUNK_SIZE) {
+        void* p = nullptr;
+        if (posix_memalign(&p, DELTA_BUFFER_ALIGN,
+                           size + DELTA_BUFFER_PAD) != 0) {
+            throw std::bad_alloc();
+        }
+        memset(static_cast<uint8_t*>(p) + size, 0, DELTA_BUFFER_PAD);
+        return static_cast<uint8_t*>(p);
+    }
     virtual uint64_t encode() = 0;
     virtual uint64_t decode(uint8_t* delta_buf, uint64_t delta_size) = 0;
+    // Called (and timed as encode time) once after a new base is loaded;
+    // every following encode() until the next call uses the same base.
+    // reused: more than one encode() will run on it, so indexing the base
+    // ahead of the first one can pay off.
+    virtual void prepareBase(bool reused) {}
+    // Encoder-specific counters, printed after the run stats.
+    virtual void printStats() {}
     bool loadInput(const std::filesystem::path& filePath) {
         std::ifstream inFile(filePath, std::ios::binary | std::ios::ate);
         if (!inFile) {
@@ -37,6 +78,11 @@ public:
             return false;
         }
         inputSize = inFile.tellg();
+        if (inputSize > MAX_CHUNK_SIZE) {
+            std::cerr << "Input file larger than MAX_CHUNK_SIZE: " << filePath
+                      << "\n";
+            return false;
+        }
         inFile.seekg(0, std::ios::beg);
         inFile.read(reinterpret_cast<char*>(inputBuf), inputSize);
         inFile.close();
@@ -50,12 +96,29 @@ public:
             return false;
         }               
         baseSize = inFile.tellg();
+        if (baseSize > MAX_CHUNK_SIZE) {
+            std::cerr << "Base file larger than MAX_CHUNK_SIZE: " << filePath
+                      << "\n";
+            return false;
+        }
         inFile.seekg(0, std::ios::beg); 
         inFile.read(reinterpret_cast<char*>(baseBuf), baseSize);
         inFile.close();
         return true;
     }
 
+    // In-memory counterparts of loadInput/loadBase for chunks already read
+    // (delta_compress --preload); size is at most MAX_CHUNK_SIZE.
+    void setInput(const uint8_t* data, uint64_t size) {
+        memcpy(inputBuf, data, size);
+        inputSize = size;
+    }
+
+    void setBase(const uint8_t* data, uint64_t size) {
+        memcpy(baseBuf, data, size);
+        baseSize = size;
+    }
+
     bool verifyDecode(uint8_t* delta_buf, uint64_t delta_size) {
         int status =  memcmp(outputBuf, inputBuf, inputSize);
        return  (status == 0);
@@ -2,10 +2,18 @@
 
 
 uint64_t FDeltaEncoder::encode() {
-    return fencode(inputBuf, static_cast<uint64_t>(inputSize), baseBuf,
+    return variant->encode(inputBuf, static_cast<uint64_t>(inputSize), baseBuf,
                    static_cast<uint64_t>(baseSize), outputBuf);
 
 }
+
+bool FDeltaEncoder::setVariant(const std::string& name) {
+    const FDeltaVariant* found = fdelta_find_variant(name);
+    if (found == nullptr) return false;
+    variant = found;
+    return true;
+}
+
 uint64_t FDeltaEncoder::decode(uint8_t* delta_buf, uint64_t delta_size) {
  return fdecode(delta_buf, static_cast<uint64_t>(delta_size), baseBuf,
                    static_cast<uint64_t>(baseSize), outputBuf);
@@ -6,8 +6,14 @@ class FDeltaEncoder final : public DeltaEncoder {
 public:
     uint64_t encode() override;
     uint64_t decode(uint8_t* delta_buf, uint64_t delta_size) override;
+    // Selects a compiled parameter set by name (fdelta_variants); false if
+    // the name is unknown.
+    bool setVariant(const std::string& name);
 
     FDeltaEncoder(){
         std::cout << "FDeltaEncoder initialized.\n";
     }
+
+private:
+    const FDeltaVariant* variant = &fdelta_variants[0];
 };
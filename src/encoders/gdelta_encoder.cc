@@ -3,11 +3,9 @@
 uint8_t* lz4Bufferr = new uint8_t[1024*64];  // 64KB buffer for LZ4 compression
 
 uint64_t GDeltaEncoder::encode() {
-    gencode(inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
+    variant->encode(inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
             static_cast<uint32_t>(baseSize), &outputBuf,
             reinterpret_cast<uint32_t*>(&outputSize));
-    std::cout << "inputSize: " << inputSize << ", baseSize: " << baseSize
-              << ", outputSize: " << outputSize << "\n";
     return outputSize;
     // uint64_t compressedSize = LZ4_compress_fast(
     //     reinterpret_cast<const char*>(outputBuf),
@@ -17,6 +15,13 @@ uint64_t GDeltaEncoder::encode() {
     // return compressedSize;
 }
 
+bool GDeltaEncoder::setVariant(const std::string& name) {
+    const GDeltaVariant* found = gdelta_find_variant(name.c_str());
+    if (found == nullptr) return false;
+    variant = found;
+    return true;
+}
+
 uint64_t GDeltaEncoder::decode(uint8_t* delta_buf, uint64_t delta_size) {
     size_t decoded_size = gdecode(delta_buf, static_cast<uint32_t>(delta_size), baseBuf,
             static_cast<uint32_t>(baseSize), &outputBuf,
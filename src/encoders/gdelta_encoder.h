@@ -10,5 +10,10 @@ class GDeltaEncoder final : public DeltaEncoder {
 public:
     uint64_t encode() override;
     uint64_t decode(uint8_t* delta_buf, uint64_t delta_size) override;
+    // Selects a compiled parameter set by name (gdelta_variants); false if
+    // the name is unknown.
+    bool setVariant(const std::string& name);
 
+private:
+    const GDeltaVariant* variant = &gdelta_variants[0];
 };
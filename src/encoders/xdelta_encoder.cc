@@ -1,17 +1,110 @@
 #include "xdelta_encoder.h"
 
+#include <chrono>
+
+XDeltaEncoder::XDeltaEncoder() {
+    xd3_memctx_init(&encodeCtx);
+    xd3_memctx_init(&decodeCtx);
+    memset(&sourceIndex, 0, sizeof(sourceIndex));
+}
+
+XDeltaEncoder::~XDeltaEncoder() {
+    xd3_memctx_free(&encodeCtx);
+    xd3_memctx_free(&decodeCtx);
+    xd3_free_source_index(&sourceIndex);
+}
+
+// "fastest" is compression level 1, the harness default. The chunk*
+// matchers were tuned for 4-64 KB chunks with xdelta_tune.
+static const struct {
+    const char* name;
+    xd3_smatch_cfg cfg;
+    int flags;
+} kMatchers[] = {
+    {"fastest", XD3_SMATCH_DEFAULT, XD3_COMPLEVEL_1},
+    {"faster", XD3_SMATCH_FASTER, 0},
+    {"fast", XD3_SMATCH_FAST, 0},
+    {"default", XD3_SMATCH_DEFAULT, 0},
+    {"slow", XD3_SMATCH_SLOW, 0},
+    {"chunkfast", XD3_SMATCH_CHUNKFAST, 0},
+    {"chunkratio", XD3_SMATCH_CHUNKRATIO, 0},
+};
+
+bool XDeltaEncoder::setMatcher(const std::string& name) {
+    for (const auto& matcher : kMatchers) {
+        if (name == matcher.name) {
+            encodeCtx.smatch_cfg = matcher.cfg;
+            matcherFlags = matcher.flags;
+            xd3_free_source_index(&sourceIndex);
+            return true;
+        }
+    }
+    return false;
+}
+
+void XDeltaEncoder::prepareBase(bool reused) {
+    auto start = std::chrono::steady_clock::now();
+    xd3_free_source_index(&sourceIndex);
+    if (!reused) {
+        return;
+    }
+    if (xd3_prepare_source_index(&encodeCtx, &sourceIndex, baseBuf,
+                                 static_cast<uint32_t>(baseSize),
+                                 matcherFlags) != 0) {
+        xd3_free_source_index(&sourceIndex);
+        return;
+    }
+    prepareNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    preparedBases++;
+}
+
 uint64_t XDeltaEncoder::encode() {
-    xd3_encode_memory(inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
-            static_cast<uint32_t>(baseSize), outputBuf,
-            &outputSize, 64 * 1024,XD3_COMPLEVEL_1);
-    std::cout << "inputSize: " << inputSize << ", baseSize: " << baseSize
-              << ", outputSize: " << outputSize << "\n";
+    int status;
+    if (sourceIndex.large_table != nullptr) {
+        status = xd3_encode_memory_indexed(&encodeCtx, &sourceIndex, inputBuf,
+                static_cast<uint32_t>(inputSize), outputBuf,
+                &outputSize, DELTA_OUTPUT_CAPACITY, matcherFlags);
+        indexedEncodes++;
+    } else {
+        status = xd3_encode_memory_ctx(&encodeCtx, inputBuf, static_cast<uint32_t>(inputSize), baseBuf,
+                static_cast<uint32_t>(baseSize), outputBuf,
+                &outputSize, DELTA_OUTPUT_CAPACITY, matcherFlags);
+    }
+    if (status != 0) {
+        std::cerr << "XDeltaEncoder::encode() failed: " << status << "\n";
+        outputSize = 0;
+        return 0;
+    }
     return outputSize;
 }
 
 uint64_t XDeltaEncoder::decode(uint8_t* delta_buf, uint64_t delta_size) {
-    size_t decoded_size = xd3_decode_memory(delta_buf, static_cast<uint32_t>(delta_size), baseBuf,
+    size_t decoded_size = xd3_decode_memory_ctx(&decodeCtx, delta_buf, static_cast<uint32_t>(delta_size), baseBuf,
             static_cast<uint32_t>(baseSize), outputBuf,
             &outputSize, 64 * 1024, 0);
     return outputSize;
-}
\ No newline at end of file
+}
+
+static void printCtxStats(const char* name, const xd3_memctx& ctx) {
+    if (ctx.calls == 0) {
+        return;
+    }
+    std::cout << "xdelta3 " << name << " setup: "
+              << static_cast<double>(ctx.setup_ns) / 1000.0 / ctx.calls
+              << " us/chunk, " << static_cast<double>(ctx.allocs) / ctx.calls
+              << " allocs/chunk, arena " << ctx.arena_size / 1024 << " KB\n";
+}
+
+void XDeltaEncoder::printStats() {
+    printCtxStats("encode", encodeCtx);
+    printCtxStats("decode", decodeCtx);
+    if (preparedBases != 0) {
+        std::cout << "xdelta3 prepared bases: " << preparedBases << ", "
+                  << static_cast<double>(indexedEncodes) / preparedBases
+                  << " targets/base, "
+                  << static_cast<double>(prepareNs) / 1000.0 / preparedBases
+                  << " us/prepare\n";
+    }
+}
@@ -5,9 +5,30 @@
 #include "xdelta3.h"
 
 
+// Keeps one xd3_memctx for the whole run, so every chunk reuses the same
+// arena for the stream's tables and buffers instead of going through
+// malloc/free. prepareBase() indexes a base that several targets use once,
+// so that they skip rebuilding xdelta3's source checksum table; a base
+// with a single target is encoded the plain way, without the prepared
+// index's extra pass.
 class XDeltaEncoder final : public DeltaEncoder {
 public:
+    XDeltaEncoder();
+    ~XDeltaEncoder() override;
+
     uint64_t encode() override;
     uint64_t decode(uint8_t* delta_buf, uint64_t delta_size) override;
+    void prepareBase(bool reused) override;
+    // Selects a string matcher by name; false if the name is unknown.
+    bool setMatcher(const std::string& name);
+    void printStats() override;
 
+private:
+    xd3_memctx encodeCtx;
+    xd3_memctx decodeCtx;
+    xd3_source_index sourceIndex;
+    int matcherFlags = XD3_COMPLEVEL_1;
+    uint64_t preparedBases = 0;
+    uint64_t indexedEncodes = 0;
+    uint64_t prepareNs = 0;
 };
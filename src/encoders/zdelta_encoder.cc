@@ -1,23 +1,45 @@
 #include "zdelta_encoder.h"
 
+ZDeltaEncoder::ZDeltaEncoder() {
+    memset(&deflateStream, 0, sizeof(deflateStream));
+    memset(&inflateStream, 0, sizeof(inflateStream));
+}
+
+ZDeltaEncoder::~ZDeltaEncoder() {
+    if (deflateStream.state != nullptr) {
+        zd_deflateEnd(&deflateStream);
+    }
+    if (inflateStream.state != nullptr) {
+        zd_inflateEnd(&inflateStream);
+    }
+}
+
+void ZDeltaEncoder::prepareBase(bool reused) {
+    baseHashed = false;
+}
+
 uint64_t ZDeltaEncoder::encode() {
-    uLongf delta_size = static_cast<uLongf>(MAX_CHUNK_SIZE);
-    int status = zd_compress(baseBuf, static_cast<uLong>(baseSize), inputBuf,
-                             static_cast<uLong>(inputSize), outputBuf,
-                             &delta_size);
+    uLongf delta_size = static_cast<uLongf>(DELTA_OUTPUT_CAPACITY);
+    int status = zd_compress_reuse(&deflateStream, baseHashed, baseBuf,
+                                   static_cast<uLong>(baseSize), inputBuf,
+                                   static_cast<uLong>(inputSize), outputBuf,
+                                   &delta_size);
     if (status != ZD_OK) {
         std::cerr << "ZDeltaEncoder::encode() failed: " << status << "\n";
+        baseHashed = false;
         return 0;
     }
+    baseHashed = true;
     outputSize = delta_size;
     return outputSize;
 }
 
 uint64_t ZDeltaEncoder::decode(uint8_t* delta_buf, uint64_t delta_size) {
     uLongf target_size = static_cast<uLongf>(inputSize);
-    int status = zd_uncompress(baseBuf, static_cast<uLong>(baseSize), outputBuf,
-                               &target_size, delta_buf,
-                               static_cast<uLong>(delta_size));
+    int status = zd_uncompress_reuse(&inflateStream, baseBuf,
+                                     static_cast<uLong>(baseSize), outputBuf,
+                                     &target_size, delta_buf,
+                                     static_cast<uLong>(delta_size));
     if (status != ZD_OK) {
         std::cerr << "ZDeltaEncoder::decode() failed: " << status << "\n";
         return 0;
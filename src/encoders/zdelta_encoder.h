@@ -4,8 +4,21 @@
 
 #include "zdlib.h"
 
+// Keeps one zdelta compression and one decompression stream for the whole
+// run and resets them between chunks, so the window and hash tables are
+// allocated once. A target against the same base as the previous one also
+// reuses the base's hash chains; prepareBase() marks a new base.
 class ZDeltaEncoder final : public DeltaEncoder {
 public:
+    ZDeltaEncoder();
+    ~ZDeltaEncoder() override;
+
     uint64_t encode() override;
     uint64_t decode(uint8_t* delta_buf, uint64_t delta_size) override;
+    void prepareBase(bool reused) override;
+
+private:
+    zd_stream deflateStream;
+    zd_stream inflateStream;
+    bool baseHashed = false;
 };
@@ -0,0 +1,154 @@
+// Measures the shared Gear boundary kernel (gear/gear.h) with the
+// parameters of each chunk encoder.
+//
+// The file is cut into strings the way each encoder walks its buffers:
+// fdelta and EDelta start the next string at the cut, DDelta one byte past
+// the byte that hit. Gdelta only takes the rolling values of its base
+// index; every rolling64 path the CPU runs goes over the same bytes and
+// has to give the values of the scalar path. The fastest of the
+// repetitions is reported.
+//
+//   gear_bench <file> [options]
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ddelta.h"
+#include "fdelta_interface.h"
+#include "gdelta.h"
+#include "gear.h"
+#include "tool_util.h"
+#include "util.h"
+
+struct Encoder {
+    const char* name;
+    const GearParams* params;
+    size_t after_hit;  // the next string starts this far past the cut
+};
+
+static const GearPath kPaths[] = {GEAR_SCALAR, GEAR_AVX512};
+
+using Clock = std::chrono::steady_clock;
+
+static double cutAll(const Encoder& enc, const uint8_t* data, size_t size,
+                     std::vector<size_t>* cuts) {
+    cuts->clear();
+    GearCutter cutter(*enc.params, data);
+    const size_t limit = enc.params->max_len;
+    auto start = Clock::now();
+    for (size_t pos = 0; pos < size;) {
+        size_t cut = cutter.next_cut(pos, size);
+        if (cut < std::min(size, pos + limit)) cut += enc.after_hit;
+        cuts->push_back(cut);
+        pos = std::max(cut, pos + 1);
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double rollAll(GearPath path, const uint8_t* data, size_t size,
+                      uint64_t* sum) {
+    const size_t block = 4096;
+    uint64_t values[block];
+    uint64_t acc = 0;
+    Clock::duration elapsed{};
+    for (size_t from = 0; from < size; from += block) {
+        size_t to = std::min(size, from + block);
+        auto start = Clock::now();
+        gear_rolling64(gdelta_gear, data, from, to, values, path);
+        elapsed += Clock::now() - start;
+        for (size_t i = 0; i < to - from; ++i) acc = acc * 31 + values[i];
+    }
+    *sum = acc;
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " <file> [options]\n\n"
+        << "Options:\n"
+        << "  -n, --limit <bytes>         Bytes of the file to scan "
+           "(default: all)\n"
+        << "  -r, --reps <count>          Passes per path, the fastest is "
+           "kept (default: 5)\n"
+        << "  -h, --help                  Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "-h" ||
+        std::string(argv[1]) == "--help") {
+        printUsage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+    uint64_t limit = UINT64_MAX;
+    int reps = 5;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "-n" || arg == "--limit") {
+            limit = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "-r" || arg == "--reps") {
+            reps = std::max(1, std::atoi(value.c_str()));
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    MappedFile file;
+    if (!mapFile(argv[1], &file)) {
+        return 1;
+    }
+    const size_t size = std::min(limit, file.size);
+    const Encoder encoders[] = {
+        {"fdelta", &fdelta_gear, 0},
+        {"edelta", &edelta_gear, 0},
+        {"ddelta", &ddelta32::ddelta_gear, 1},
+    };
+
+    std::cout << "params,path,bytes,cuts,gbps\n";
+    bool ok = true;
+    for (const Encoder& enc : encoders) {
+        std::vector<size_t> cuts;
+        double best = 0.0;
+        for (int r = 0; r < reps; ++r) {
+            double seconds = cutAll(enc, file.data, size, &cuts);
+            best = r == 0 ? seconds : std::min(best, seconds);
+        }
+        std::cout << enc.name << "," << gear_path_name(GEAR_SCALAR) << ","
+                  << size << "," << cuts.size() << "," << std::fixed
+                  << std::setprecision(2) << size / best / 1e9 << "\n";
+    }
+
+    uint64_t expected = 0;
+    rollAll(GEAR_SCALAR, file.data, size, &expected);
+    for (GearPath path : kPaths) {
+        if (!gear_has_path(path)) {
+            continue;
+        }
+        double best = 0.0;
+        uint64_t sum = 0;
+        for (int r = 0; r < reps; ++r) {
+            double seconds = rollAll(path, file.data, size, &sum);
+            best = r == 0 ? seconds : std::min(best, seconds);
+        }
+        if (sum != expected) {
+            std::cerr << "gdelta " << gear_path_name(path)
+                      << ": rolling values differ from the scalar path\n";
+            ok = false;
+        }
+        std::cout << "gdelta," << gear_path_name(path) << "," << size
+                  << ",0," << std::fixed << std::setprecision(2)
+                  << size / best / 1e9 << "\n";
+    }
+    return ok ? 0 : 1;
+}
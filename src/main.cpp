@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
@@ -5,8 +6,10 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "alloc_stats.h"
 #include "decode.hpp"
 #include "encoders/fdelta_encoder.h"
 #include "encoders/gdelta_encoder.h"
@@ -14,6 +17,9 @@
 #include "encoders/edelta_encoder.h"
 #include "encoders/zdelta_encoder.h"
 #include "encoders/ddelta_encoder.h"
+#include "hugemem.h"
+#include "isa.h"
+#include "perf_counters.h"
 
 
 namespace fs = std::filesystem;
@@ -24,6 +30,24 @@ double total_encoding_time = 0.0;
 uint64_t total_decoded_size = 0;
 double total_decoding_time = 0.0;
 
+// Heap use of the encode() or decode() calls of the run (--alloc-stats).
+struct HeapTotals {
+    uint64_t calls = 0;
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+    uint64_t peak = 0;  // largest of any one call
+
+    void add(const AllocCall& call) {
+        calls++;
+        allocs += call.allocs;
+        bytes += call.bytes;
+        peak = std::max(peak, call.peak);
+    }
+};
+
+HeapTotals encode_heap;
+HeapTotals decode_heap;
+
 struct Options {
     std::string dataset = "linux";
     std::string encoder_type = "fdelta";
@@ -33,6 +57,17 @@ struct Options {
     bool write_delta = false;
     bool verify_decode = false;
     bool write_decoded = false;
+    bool legacy_format = false;
+    bool group_by_base = false;
+    std::string xdelta_matcher = "fastest";
+    std::string variant = "default";
+    std::string isa = "auto";
+    std::string huge_pages = "off";
+    bool alloc_stats = false;
+    bool preload = false;
+    uint32_t reps = 5;
+    uint32_t warmup = 1;
+    uint64_t preload_budget_mb = 1024;
 };
 
 static void printUsage(const char* program) {
@@ -53,6 +88,38 @@ static void printUsage(const char* program) {
            "<input_hash>.decoded\n"
         << "  -v, --verify-decode         Decode-only: assert delta+base == "
            "input\n"
+        << "  -L, --legacy-format         Write fixed-size records (edelta)\n"
+        << "  -g, --group-by-base         Process rows sharing a base_hash "
+           "back to back\n"
+        << "  -m, --matcher <name>        xdelta string matcher: fastest|"
+           "faster|fast|default|slow|\n"
+        << "                              chunkfast|chunkratio (default: "
+           "fastest)\n"
+        << "  -V, --variant <name>        Compiled parameter set (default: "
+           "default)\n"
+        << "                              fdelta: default|h64|h32|n6|max1k|"
+           "max4k\n"
+        << "                              gdelta: default|s1|s4|w4|noskip|"
+           "noreverse\n"
+        << "  -i, --isa <name>            Kernel instruction set: auto|scalar|"
+           "avx2|avx512\n"
+        << "                              (default: auto, the best the CPU "
+           "runs)\n"
+        << "  -H, --huge-pages <mode>     Scratch memory of gdelta/xdelta: off|"
+           "thp|hugetlb\n"
+        << "                              (default: off; hugetlb falls back "
+           "to thp)\n"
+        << "  -a, --alloc-stats           Count heap allocations per encode/"
+           "decode call\n"
+        << "  -P, --preload               Read the pairs into memory first, "
+           "then time\n"
+        << "                              encoding only, over --reps runs\n"
+        << "  -r, --reps <count>          Timed runs with --preload "
+           "(default: 5)\n"
+        << "  -u, --warmup <count>        Untimed runs before them "
+           "(default: 1)\n"
+        << "  -B, --budget <MB>           Memory for preloaded chunks "
+           "(default: 1024)\n"
         << "  -h, --help                  Show this help\n";
 }
 
@@ -95,12 +162,63 @@ static bool parseArgs(int argc, char* argv[], Options* options,
                 return false;
             }
             options->delta_dir = argv[++i];
+        } else if (arg == "-L" || arg == "--legacy-format") {
+            options->legacy_format = true;
+        } else if (arg == "-g" || arg == "--group-by-base") {
+            options->group_by_base = true;
+        } else if (arg == "-m" || arg == "--matcher") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->xdelta_matcher = argv[++i];
+        } else if (arg == "-V" || arg == "--variant") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->variant = argv[++i];
+        } else if (arg == "-i" || arg == "--isa") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->isa = argv[++i];
+        } else if (arg == "-H" || arg == "--huge-pages") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->huge_pages = argv[++i];
         } else if (arg == "-w" || arg == "--write-delta") {
             options->write_delta = true;
         } else if (arg == "-W" || arg == "--write-decoded") {
             options->write_decoded = true;
         } else if (arg == "-v" || arg == "--verify-decode") {
             options->verify_decode = true;
+        } else if (arg == "-a" || arg == "--alloc-stats") {
+            options->alloc_stats = true;
+        } else if (arg == "-P" || arg == "--preload") {
+            options->preload = true;
+        } else if (arg == "-r" || arg == "--reps") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->reps = std::max<uint32_t>(
+                1, static_cast<uint32_t>(std::stoul(argv[++i])));
+        } else if (arg == "-u" || arg == "--warmup") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "-B" || arg == "--budget") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            options->preload_budget_mb = std::stoull(argv[++i]);
         } else {
             std::cerr << "Unknown argument: " << arg << "\n";
             printUsage(argv[0]);
@@ -110,6 +228,283 @@ static bool parseArgs(int argc, char* argv[], Options* options,
     return true;
 }
 
+static std::string baseHashOf(const std::string& row) {
+    size_t first = row.find(',');
+    size_t second = row.find(',', first + 1);
+    size_t third = row.find(',', second + 1);
+    if (first == std::string::npos || second == std::string::npos) {
+        return std::string();
+    }
+    return row.substr(second + 1, third - second - 1);
+}
+
+// Stable grouping: bases keep the order of their first row and rows keep
+// their order within a base.
+static void groupRowsByBase(std::vector<std::string>* rows) {
+    std::unordered_map<std::string, size_t> first_seen;
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(rows->size());
+    for (size_t i = 0; i < rows->size(); ++i) {
+        auto it = first_seen.emplace(baseHashOf((*rows)[i]), i).first;
+        order.emplace_back(it->second, i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<size_t, size_t>& a,
+                        const std::pair<size_t, size_t>& b) {
+                         return a.first < b.first;
+                     });
+    std::vector<std::string> grouped;
+    grouped.reserve(rows->size());
+    for (const auto& entry : order) {
+        grouped.push_back(std::move((*rows)[entry.second]));
+    }
+    rows->swap(grouped);
+}
+
+static void printCounter(const PerfCounters& counters,
+                         PerfCounters::Counter c) {
+    if (counters.available(c)) {
+        std::cout << counters.value(c);
+    } else {
+        std::cout << "n/a";
+    }
+}
+
+static void printHeap(const std::string& encoder, const char* what,
+                      const HeapTotals& heap) {
+    if (heap.calls == 0) return;
+    std::cout << "Heap per " << encoder << " " << what << " call: "
+              << static_cast<double>(heap.allocs) / heap.calls
+              << " allocations, "
+              << static_cast<double>(heap.bytes) / heap.calls
+              << " bytes; peak live " << heap.peak << " bytes\n";
+}
+
+static void printMemoryStats(const PerfCounters& counters) {
+    hugemem_stats_t huge;
+    hugemem_get_stats(&huge);
+    std::cout << "Huge pages: " << hugemem_mode_name(hugemem_mode())
+              << " (regions: " << huge.hugetlb << " hugetlb, " << huge.thp
+              << " thp, " << huge.reused << " reused)\n";
+    std::cout << "dTLB misses (load/store): ";
+    printCounter(counters, PerfCounters::DTLB_LOAD_MISSES);
+    std::cout << " / ";
+    printCounter(counters, PerfCounters::DTLB_STORE_MISSES);
+    std::cout << ", page faults: ";
+    printCounter(counters, PerfCounters::PAGE_FAULTS);
+    std::cout << "\n";
+}
+
+// --preload: a pair of the map, its chunks at offsets of the arena. A base
+// named by several rows is stored once.
+struct PreloadedPair {
+    std::string delta_id;
+    uint64_t base_off, base_size;
+    uint64_t input_off, input_size;
+    bool new_base;  // not the base of the previous pair
+    bool base_reused = false;  // the base of the next pair too
+};
+
+static std::string hashField(std::istringstream& ss) {
+    std::string field;
+    std::getline(ss, field, ',');
+    return field;
+}
+
+// Whether the row after rows[row] is on the same base; with -g every row
+// of a shared base is followed by another until its last.
+static bool baseReused(const std::vector<std::string>& rows, size_t row,
+                       const std::string& base_hash) {
+    if (row + 1 >= rows.size()) return false;
+    std::istringstream ss(rows[row + 1]);
+    hashField(ss);
+    hashField(ss);
+    return hashField(ss) == base_hash;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Reads the chunks of the rows into one arena, up to the budget, then
+// encodes them warmup + reps times. Only prepareBase() and encode() are
+// timed; copying a chunk from the arena into the encoder's buffers is not.
+static int runPreloaded(const Options& options, DeltaEncoder* encoder,
+                        const std::vector<std::string>& rows,
+                        const fs::path& data_path, PerfCounters& counters) {
+    const uint64_t budget = options.preload_budget_mb << 20;
+    std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> placed;
+    std::vector<std::pair<fs::path, std::pair<uint64_t, uint64_t>>> reads;
+    std::vector<PreloadedPair> pairs;
+    uint64_t arena_size = 0;
+    bool over_budget = false;
+
+    // Offset and size of a chunk in the arena, placing it if new; false
+    // when the file is unusable or would pass the budget.
+    auto place = [&](const std::string& hash, uint64_t* off, uint64_t* size) {
+        auto it = placed.find(hash);
+        if (it != placed.end()) {
+            *off = it->second.first;
+            *size = it->second.second;
+            return true;
+        }
+        fs::path path = data_path / hash;
+        std::error_code ec;
+        uint64_t n = fs::file_size(path, ec);
+        if (ec) {
+            std::cerr << "Failed to open chunk: " << path << "\n";
+            return false;
+        }
+        if (n > MAX_CHUNK_SIZE) {
+            std::cerr << "Chunk larger than MAX_CHUNK_SIZE: " << path << "\n";
+            return false;
+        }
+        if (arena_size + n > budget) {
+            over_budget = true;
+            return false;
+        }
+        *off = arena_size;
+        *size = n;
+        placed.emplace(hash, std::make_pair(arena_size, n));
+        reads.emplace_back(path, std::make_pair(arena_size, n));
+        arena_size += n;
+        return true;
+    };
+
+    std::string previous_base;
+    for (const std::string& line : rows) {
+        std::istringstream ss(line);
+        PreloadedPair pair;
+        pair.delta_id = hashField(ss);
+        std::string original_hash = hashField(ss);
+        std::string base_hash = hashField(ss);
+        // A pair whose input does not fit leaves its base placed, unused.
+        if (!place(base_hash, &pair.base_off, &pair.base_size) ||
+            !place(original_hash, &pair.input_off, &pair.input_size)) {
+            if (over_budget) break;
+            continue;
+        }
+        pair.new_base = pairs.empty() || base_hash != previous_base;
+        previous_base = base_hash;
+        pairs.push_back(pair);
+    }
+    for (size_t i = 0; i + 1 < pairs.size(); ++i) {
+        pairs[i].base_reused = !pairs[i + 1].new_base;
+    }
+    if (pairs.empty()) {
+        std::cerr << "No pairs to preload\n";
+        return 1;
+    }
+
+    uint8_t* arena = static_cast<uint8_t*>(hugemem_alloc(arena_size));
+    if (!arena) {
+        std::cerr << "Failed to allocate " << arena_size
+                  << " bytes for preloading\n";
+        return 1;
+    }
+    for (const auto& read : reads) {
+        std::ifstream in(read.first, std::ios::binary);
+        if (!in.read(reinterpret_cast<char*>(arena + read.second.first),
+                     static_cast<std::streamsize>(read.second.second))) {
+            std::cerr << "Failed to read chunk: " << read.first << "\n";
+            hugemem_free(arena);
+            return 1;
+        }
+    }
+    std::cout << "Preloaded " << pairs.size() << " of " << rows.size()
+              << " pairs, " << placed.size() << " chunks, " << arena_size
+              << " bytes";
+    if (over_budget) {
+        std::cout << " (budget of " << options.preload_budget_mb
+                  << " MB reached)";
+    }
+    std::cout << "\n";
+
+    std::vector<double> runs;  // MB/s of each timed run
+    uint64_t original_size = 0;
+    uint64_t encoded_size = 0;
+    bool sizes_differ = false;
+    uint64_t failed = 0;  // encodes that returned 0, per run
+    for (uint32_t rep = 0; rep < options.warmup + options.reps; ++rep) {
+        const bool timed = rep >= options.warmup;
+        double seconds = 0.0;
+        uint64_t run_original = 0;
+        uint64_t run_encoded = 0;
+        uint64_t run_failed = 0;
+        for (const PreloadedPair& pair : pairs) {
+            if (pair.new_base) {
+                encoder->setBase(arena + pair.base_off, pair.base_size);
+            }
+            encoder->setInput(arena + pair.input_off, pair.input_size);
+            AllocMark heap_mark = alloc_stats_begin();
+            if (timed) counters.start();
+            auto start = std::chrono::steady_clock::now();
+            if (pair.new_base) {
+                encoder->prepareBase(pair.base_reused);
+            }
+            uint64_t size = encoder->encode();
+            auto end = std::chrono::steady_clock::now();
+            if (timed) {
+                counters.stop();
+                encode_heap.add(alloc_stats_end(heap_mark));
+            }
+            if (size == 0) {  // failed, as in the file-based loop
+                run_failed++;
+                continue;
+            }
+            seconds += std::chrono::duration<double>(end - start).count();
+            run_original += pair.input_size;
+            run_encoded += size;
+        }
+        failed = run_failed;
+        if (rep > 0 && run_encoded != encoded_size) sizes_differ = true;
+        original_size = run_original;
+        encoded_size = run_encoded;
+        if (timed) {
+            runs.push_back(seconds > 0.0
+                               ? run_original / (1024.0 * 1024.0) / seconds
+                               : 0.0);
+        }
+    }
+    hugemem_free(arena);
+
+    double mid = median(runs);
+    auto range = std::minmax_element(runs.begin(), runs.end());
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "\nStats (preloaded, " << options.reps << " runs after "
+              << options.warmup << " warmup)\n";
+    std::cout << "Total original size: " << original_size << " bytes ("
+              << original_size / 1024.0 / 1024.0 << " MB) per run\n";
+    std::cout << "Total encoded size: " << encoded_size << " bytes ("
+              << encoded_size / 1024.0 / 1024.0 << " MB) per run\n";
+    if (failed != 0) {
+        std::cout << "Failed encodes: " << failed
+                  << " per run, left out of the totals\n";
+    }
+    if (sizes_differ) {
+        std::cout << "Warning: encoded size differed between runs\n";
+    }
+    std::cout << "Throughput: " << mid << " MB/s (median)\n";
+    std::cout << "Throughput spread: min " << *range.first << ", max "
+              << *range.second << " MB/s ("
+              << (mid > 0.0 ? (*range.second - *range.first) / mid * 100.0
+                            : 0.0)
+              << "% of median)\n";
+    std::cout << "Kernel ISA: " << delta_isa_name(delta_isa) << "\n";
+    printMemoryStats(counters);
+    if (options.alloc_stats) {
+        printHeap(options.encoder_type, "encode", encode_heap);
+    }
+    std::cout << "Peak RSS: " << peak_rss_kb() << " KB\n";
+    if (encoded_size > 0) {
+        std::cout << "Delta compression ratio (input/output): "
+                  << static_cast<double>(original_size) / encoded_size << "\n";
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     Options options;
     bool show_help = false;
@@ -119,6 +514,20 @@ int main(int argc, char* argv[]) {
     if (show_help) {
         return 0;
     }
+    if (!delta_isa_set(options.isa.c_str())) {
+        std::cerr << "Unknown instruction set or not supported by this CPU: "
+                  << options.isa << "\n";
+        return 1;
+    }
+    if (!hugemem_set_mode(options.huge_pages.c_str())) {
+        std::cerr << "Unknown huge page mode: " << options.huge_pages << "\n";
+        return 1;
+    }
+    if (options.alloc_stats && !alloc_stats_enable()) {
+        std::cerr << "--alloc-stats needs a build with DELTA_ALLOC_STATS\n";
+        return 1;
+    }
+    PerfCounters counters;
 
     auto data_path = options.path_prefix / options.dataset / "chunks";
     auto map_path =
@@ -129,13 +538,31 @@ int main(int argc, char* argv[]) {
     DeltaEncoder* encoder = nullptr;
 
     if (options.encoder_type == "fdelta") {
-        encoder = new FDeltaEncoder();
+        FDeltaEncoder* fdelta = new FDeltaEncoder();
+        if (!fdelta->setVariant(options.variant)) {
+            std::cerr << "Unknown fdelta variant: " << options.variant << "\n";
+            return 1;
+        }
+        encoder = fdelta;
     } else if (options.encoder_type == "gdelta") {
-        encoder = new GDeltaEncoder();
+        GDeltaEncoder* gdelta = new GDeltaEncoder();
+        if (!gdelta->setVariant(options.variant)) {
+            std::cerr << "Unknown gdelta variant: " << options.variant << "\n";
+            return 1;
+        }
+        encoder = gdelta;
     } else if (options.encoder_type == "xdelta") {
-        encoder = new XDeltaEncoder();
+        XDeltaEncoder* xdelta = new XDeltaEncoder();
+        if (!xdelta->setMatcher(options.xdelta_matcher)) {
+            std::cerr << "Unknown xdelta matcher: " << options.xdelta_matcher
+                      << "\n";
+            return 1;
+        }
+        encoder = xdelta;
     } else if (options.encoder_type == "edelta") {
         encoder = new EDeltaEncoder();
+        edelta_set_format(options.legacy_format ? EDELTA_FORMAT_LEGACY
+                                                : EDELTA_FORMAT_VARINT);
     } else if (options.encoder_type == "zdelta") {
         encoder = new ZDeltaEncoder();
     } else if (options.encoder_type == "ddelta") {
@@ -146,12 +573,25 @@ int main(int argc, char* argv[]) {
         std::cerr << "Unknown encoder type: " << options.encoder_type << "\n";
         return 1;
     }
+    if (options.variant != "default" && options.encoder_type != "fdelta" &&
+        options.encoder_type != "gdelta") {
+        std::cerr << options.encoder_type
+                  << " has no variants; --variant is for fdelta and gdelta\n";
+        return 1;
+    }
 
     if (options.verify_decode && options.write_delta) {
         std::cerr
             << "Choose either --verify-decode or --write-delta, not both\n";
         return 1;
     }
+    if (options.preload &&
+        (options.verify_decode || options.write_delta ||
+         options.write_decoded)) {
+        std::cerr << "--preload only encodes; drop --verify-decode, "
+                     "--write-delta and --write-decoded\n";
+        return 1;
+    }
 
     // delta_id,original_hash,base_hash,base_size,original_size,delta_size,base_level,estimated_similarity
     std::ifstream map_file(map_path);
@@ -162,8 +602,25 @@ int main(int argc, char* argv[]) {
     std::string line;
     // Skip header
     std::getline(map_file, line);
-    while (std::getline(map_file, line)) {
-        if (options.total_chunks-- == 0) break;
+    std::vector<std::string> rows;
+    while (rows.size() < options.total_chunks &&
+           std::getline(map_file, line)) {
+        rows.push_back(line);
+    }
+    if (options.group_by_base) {
+        groupRowsByBase(&rows);
+    }
+    if (options.preload) {
+        int status =
+            runPreloaded(options, encoder, rows, data_path, counters);
+        encoder->printStats();
+        return status;
+    }
+
+    // Rows that share a base only load (and prepare) it once.
+    std::string loaded_base;
+    for (size_t row = 0; row < rows.size(); ++row) {
+        const std::string& line = rows[row];
         std::istringstream ss(line);
         std::string delta_id, original_hash, base_hash;
         uint64_t base_size, original_size, delta_size, base_level;
@@ -187,22 +644,48 @@ int main(int argc, char* argv[]) {
         std::cout << "Processing Delta ID: " << delta_id
                   << " Base: " << base_path << " Original: " << original_path
                   << "\n";
-        if (!encoder->loadBase(base_path)) {
-            std::cerr << "Failed to load base chunk: " << base_path << "\n";
-            continue;
+        bool new_base = base_hash != loaded_base;
+        if (new_base) {
+            loaded_base.clear();
+            if (!encoder->loadBase(base_path)) {
+                std::cerr << "Failed to load base chunk: " << base_path << "\n";
+                continue;
+            }
+            loaded_base = base_hash;
         }
         if (!encoder->loadInput(original_path)) {
             std::cerr << "Failed to load input chunk: " << original_path
                       << "\n";
+            // The base was loaded but prepareBase() not run for it; the
+            // next row on it must not take the previous base's state.
+            if (new_base) loaded_base.clear();
             continue;
         }
 
         fs::path delta_path = delta_dir / (original_hash + ".delta");
         if (!options.verify_decode) {
+            AllocMark heap_mark = alloc_stats_begin();
+            counters.start();
             auto start = std::chrono::steady_clock::now();
+            if (new_base) {
+                encoder->prepareBase(baseReused(rows, row, base_hash));
+            }
             uint64_t encoded_size = encoder->encode();
             auto end = std::chrono::steady_clock::now();
+            counters.stop();
+            encode_heap.add(alloc_stats_end(heap_mark));
             std::chrono::duration<double> elapsed = end - start;
+            // Logged here, outside the timed region, and not at all by
+            // --preload.
+            std::cout << "inputSize: " << encoder->inputSize
+                      << ", baseSize: " << encoder->baseSize
+                      << ", outputSize: " << encoded_size << "\n";
+            if (encoded_size == 0) {
+                // no delta: the row counts nowhere and writes no file
+                std::cerr << "Encoding failed for delta: " << delta_id
+                          << "\n";
+                continue;
+            }
 
             total_encoding_time += elapsed.count();
             total_original_size += encoder->inputSize;
@@ -223,8 +706,9 @@ int main(int argc, char* argv[]) {
             }
         } else {
             if (!fs::exists(delta_path)) {
+                // rows whose encode failed have no delta
                 std::cerr << "Delta chunk not found: " << delta_path << "\n";
-                return 1;
+                continue;
             }
             std::ifstream delta_in(delta_path,
                                    std::ios::binary | std::ios::ate);
@@ -241,6 +725,7 @@ int main(int argc, char* argv[]) {
             delta_in.read(reinterpret_cast<char*>(delta_buf),
                             static_cast<std::streamsize>(deltaSize));
 
+            AllocMark heap_mark = alloc_stats_begin();
             auto decode_start = std::chrono::steady_clock::now();
             bool ok = false;
             uint64_t decoded_size = 0;
@@ -264,6 +749,7 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             auto decode_end = std::chrono::steady_clock::now();
+            decode_heap.add(alloc_stats_end(heap_mark));
             std::chrono::duration<double> decode_elapsed =
                 decode_end - decode_start;
 
@@ -316,6 +802,12 @@ int main(int argc, char* argv[]) {
                   << total_encoded_size / 1024.0 / 1024.0 << " MB)\n";
         std::cout << "Total encode time: " << total_encoding_time << " s\n";
         std::cout << "Throughput: " << throughput << " MB/s\n";
+        std::cout << "Kernel ISA: " << delta_isa_name(delta_isa) << "\n";
+        printMemoryStats(counters);
+        if (options.alloc_stats) {
+            printHeap(options.encoder_type, "encode", encode_heap);
+        }
+        std::cout << "Peak RSS: " << peak_rss_kb() << " KB\n";
         std::cout << "Delta compression ratio (input/output): "
                   << compression_ratio << "\n";
         std::cout << "Delta compression efficiency: " << efficiency << "%\n";
@@ -331,5 +823,13 @@ int main(int argc, char* argv[]) {
         std::cout << "Total decode size: " << total_decoded_size << " bytes\n";
         std::cout << "Total decode time: " << total_decoding_time << " s\n";
         std::cout << "Decode throughput: " << decode_throughput << " MB/s\n";
+        std::cout << "Kernel ISA: " << delta_isa_name(delta_isa) << "\n";
+        if (options.alloc_stats) {
+            printHeap(options.encoder_type, "encode", encode_heap);
+            printHeap(options.encoder_type, "decode", decode_heap);
+        }
+        std::cout << "Peak RSS: " << peak_rss_kb() << " KB\n";
     }
+
+    encoder->printStats();
 }
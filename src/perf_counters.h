@@ -0,0 +1,73 @@
+#pragma once
+// Hardware and kernel counters of this process over the timed encode
+// calls, read with perf_event_open. A counter the machine or the kernel
+// does not offer (no PMU inside most VMs, perf_event_paranoid above 2)
+// stays unavailable and is reported as n/a. Kernel-side events are
+// excluded so that paranoid level 2 is enough.
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+class PerfCounters {
+public:
+    enum Counter { DTLB_LOAD_MISSES, DTLB_STORE_MISSES, PAGE_FAULTS, COUNT };
+
+    PerfCounters() {
+        open(DTLB_LOAD_MISSES, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        open(DTLB_STORE_MISSES, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
+                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        open(PAGE_FAULTS, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // The counters run from start() to stop() and add up across calls.
+    void start() {
+        if (leader_ >= 0) ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    void stop() {
+        if (leader_ >= 0) ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    bool available(Counter c) const { return fds_[c] >= 0; }
+
+    uint64_t value(Counter c) const {
+        uint64_t v = 0;
+        if (fds_[c] < 0 || read(fds_[c], &v, sizeof(v)) != sizeof(v)) return 0;
+        return v;
+    }
+
+private:
+    void open(Counter c, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = leader_ < 0;  // members follow the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int fd = static_cast<int>(
+            syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+        fds_[c] = fd;
+        if (fd >= 0 && leader_ < 0) leader_ = fd;
+    }
+
+    int fds_[COUNT] = {-1, -1, -1};
+    int leader_ = -1;
+};
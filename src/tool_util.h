@@ -0,0 +1,122 @@
+#pragma once
+// Helpers shared by the stand-alone measurement tools (xdelta_stream,
+// zdelta_stream, zdelta_window, gear_bench): read-only file mappings,
+// size arguments, peak RSS and child processes that are measured on
+// their own.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+    int fd = -1;
+};
+
+// Maps the whole file read-only. An empty file maps to a non-null pointer
+// and size 0; callers that cannot use it check the size.
+static inline bool mapFile(const std::string& path, MappedFile* out) {
+    out->fd = open(path.c_str(), O_RDONLY);
+    if (out->fd < 0) {
+        std::cerr << "Failed to open " << path << ": " << strerror(errno)
+                  << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(out->fd, &st) != 0) {
+        std::cerr << "Failed to stat " << path << "\n";
+        return false;
+    }
+    out->size = static_cast<uint64_t>(st.st_size);
+    if (out->size == 0) {
+        // mmap rejects empty files; any non-null pointer will do.
+        static const uint8_t empty = 0;
+        out->data = &empty;
+        return true;
+    }
+    void* p = mmap(nullptr, out->size, PROT_READ, MAP_PRIVATE, out->fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to mmap " << path << ": " << strerror(errno)
+                  << "\n";
+        return false;
+    }
+    out->data = static_cast<const uint8_t*>(p);
+    return true;
+}
+
+static inline void unmapFile(MappedFile* file) {
+    if (file->size != 0 && file->data != nullptr) {
+        munmap(const_cast<uint8_t*>(file->data), file->size);
+    }
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    *file = MappedFile();
+}
+
+// A byte count with an optional K, M or G suffix (powers of 1024); zero
+// is rejected.
+static inline bool parseSize(const std::string& text, uint64_t* out) {
+    char* end = nullptr;
+    uint64_t value = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str()) {
+        return false;
+    }
+    switch (*end) {
+        case 'k': case 'K': value <<= 10; ++end; break;
+        case 'm': case 'M': value <<= 20; ++end; break;
+        case 'g': case 'G': value <<= 30; ++end; break;
+        default: break;
+    }
+    *out = value;
+    return *end == '\0' && value > 0;
+}
+
+static inline double peakRssMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// One line per encode or decode run of the stream tools. Throughput is
+// always quoted in target bytes.
+static inline void report(const char* what, uint64_t in_bytes,
+                          uint64_t out_bytes, uint64_t target_bytes,
+                          double seconds) {
+    std::cout << std::fixed << std::setprecision(3) << what << ": "
+              << in_bytes << " -> " << out_bytes << " bytes, " << seconds
+              << " s, "
+              << (seconds > 0.0 ? target_bytes / (1024.0 * 1024.0) / seconds
+                                : 0.0)
+              << " MB/s, peak RSS " << peakRssMB() << " MB\n";
+}
+
+// Runs fn in a child and returns its exit status; *rss_mb is the child's
+// own peak RSS.
+template <typename Fn>
+static int inChild(Fn fn, double* rss_mb) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(fn());
+    }
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) != pid) {
+        return 1;
+    }
+    *rss_mb = usage.ru_maxrss / 1024.0;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
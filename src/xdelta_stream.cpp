@@ -0,0 +1,377 @@
+// Streaming xdelta3 for inputs that do not fit the 64 KB chunk harness.
+//
+// The base is mmap'd and handed to xdelta3 one source block at a time
+// through the getblk callback, so a source block is never copied. The
+// target (or delta) is read one window at a time and the output is written
+// as soon as xdelta3 produces it. Memory is bounded by the target window,
+// the source window's checksum table and the source pages xdelta3 can still
+// reach; pages further behind are released with MADV_DONTNEED.
+//
+//   xdelta_stream encode <base> <target> <delta> [options]
+//   xdelta_stream decode <base> <delta> <output> [options]
+//   xdelta_stream sweep  <base> <target> [options]
+//
+// sweep encodes, decodes and verifies once per window size, each step in
+// its own child process so that every peak RSS is measured on its own.
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tool_util.h"
+#include "xdelta3.h"
+
+struct StreamOptions {
+    uint64_t window = 8ULL << 20;          // target window
+    uint64_t block = 1ULL << 20;           // source block
+    uint64_t source_window = 64ULL << 20;  // how far xdelta3 looks in the base
+    int level = 1;
+    std::vector<uint64_t> windows = {256ULL << 10, 1ULL << 20, 4ULL << 20,
+                                     16ULL << 20, 64ULL << 20};
+    std::string tmp_dir = "/tmp";
+};
+
+// getblk state. Everything below `released` has been dropped from RSS.
+struct MappedSource {
+    MappedFile file;
+    uint64_t reach = 0;     // bytes behind the newest block xdelta3 may use
+    uint64_t released = 0;
+    uint64_t newest = 0;
+};
+
+// Clean file pages can always be faulted back in, so releasing too much
+// only costs a re-read, never correctness.
+static void releaseBehind(MappedSource* src, uint64_t offset) {
+    if (offset <= src->newest) {
+        return;
+    }
+    src->newest = offset;
+    if (offset < src->reach) {
+        return;
+    }
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t limit = (offset - src->reach) & ~(page - 1);
+    // Batch the madvise calls to one per quarter of the reach.
+    if (limit < src->released + src->reach / 4) {
+        return;
+    }
+    madvise(const_cast<uint8_t*>(src->file.data) + src->released,
+            limit - src->released, MADV_DONTNEED);
+    src->released = limit;
+}
+
+static int mmapGetblk(xd3_stream* stream, xd3_source* source, xoff_t blkno) {
+    MappedSource* src = static_cast<MappedSource*>(stream->opaque);
+    uint64_t offset = static_cast<uint64_t>(blkno) * source->blksize;
+    if (offset > src->file.size) {
+        stream->msg = "source block past the end of the base";
+        return XD3_INVALID_INPUT;
+    }
+    source->curblkno = blkno;
+    source->curblk = src->file.data + offset;
+    source->onblk = static_cast<usize_t>(
+        std::min<uint64_t>(source->blksize, src->file.size - offset));
+    releaseBehind(src, offset);
+    return 0;
+}
+
+// Runs one encode (is_encode) or decode from `in` to `out` against the
+// mapped base. Returns the number of bytes read from `in`, or -1.
+static int64_t runStream(bool is_encode, const std::string& base_path,
+                         const std::string& in_path,
+                         const std::string& out_path,
+                         const StreamOptions& options, uint64_t* out_bytes) {
+    MappedSource src;
+    if (!mapFile(base_path, &src.file)) {
+        return -1;
+    }
+    FILE* in = fopen(in_path.c_str(), "rb");
+    FILE* out = fopen(out_path.c_str(), "wb");
+    if (in == nullptr || out == nullptr) {
+        std::cerr << "Failed to open " << (in ? out_path : in_path) << "\n";
+        if (in) fclose(in);
+        if (out) fclose(out);
+        unmapFile(&src.file);
+        return -1;
+    }
+
+    xd3_stream stream;
+    xd3_config config;
+    xd3_source source;
+    memset(&stream, 0, sizeof(stream));
+    memset(&config, 0, sizeof(config));
+    memset(&source, 0, sizeof(source));
+
+    usize_t window = static_cast<usize_t>(
+        std::min<uint64_t>(options.window, XD3_HARDMAXWINSIZE));
+    config.winsize = window;
+    config.sprevsz = 1;
+    while (config.sprevsz < std::min<usize_t>(window, 1U << 23)) {
+        config.sprevsz <<= 1;
+    }
+    config.flags = options.level << XD3_COMPLEVEL_SHIFT;
+    config.getblk = mmapGetblk;
+    config.opaque = &src;
+
+    // A window smaller than the base's power-of-two size keeps the
+    // checksum table small; max_winsize is rounded up by xd3_set_source.
+    source.blksize = static_cast<usize_t>(options.block);
+    source.max_winsize = std::max<xoff_t>(
+        std::min<uint64_t>(options.source_window, src.file.size),
+        XD3_ALLOCSIZE);
+    src.reach = 2 * std::max<uint64_t>(options.source_window, options.block);
+
+    int64_t consumed = -1;
+    std::vector<uint8_t> buf(window);
+    *out_bytes = 0;
+
+    int ret = xd3_config_stream(&stream, &config);
+    if (ret == 0) {
+        ret = xd3_set_source_and_size(&stream, &source, src.file.size);
+    }
+    if (ret != 0) {
+        std::cerr << "xdelta3 setup failed: "
+                  << (stream.msg ? stream.msg : xd3_strerror(ret)) << "\n";
+        goto done;
+    }
+
+    consumed = 0;
+    for (bool eof = false; !eof;) {
+        size_t n = fread(buf.data(), 1, buf.size(), in);
+        if (n < buf.size()) {
+            if (ferror(in)) {
+                std::cerr << "Failed to read " << in_path << "\n";
+                consumed = -1;
+                goto done;
+            }
+            eof = true;
+            xd3_set_flags(&stream, XD3_FLUSH | stream.flags);
+        }
+        consumed += n;
+        xd3_avail_input(&stream, buf.data(), static_cast<usize_t>(n));
+
+        for (;;) {
+            ret = is_encode ? xd3_encode_input(&stream)
+                            : xd3_decode_input(&stream);
+            if (ret == XD3_INPUT) {
+                break;
+            }
+            if (ret == XD3_OUTPUT) {
+                if (fwrite(stream.next_out, 1, stream.avail_out, out) !=
+                    stream.avail_out) {
+                    std::cerr << "Failed to write " << out_path << "\n";
+                    consumed = -1;
+                    goto done;
+                }
+                *out_bytes += stream.avail_out;
+                xd3_consume_output(&stream);
+                continue;
+            }
+            if (ret == XD3_GOTHEADER || ret == XD3_WINSTART ||
+                ret == XD3_WINFINISH) {
+                continue;
+            }
+            std::cerr << (is_encode ? "encode" : "decode") << " error: "
+                      << (stream.msg ? stream.msg : xd3_strerror(ret)) << "\n";
+            consumed = -1;
+            goto done;
+        }
+    }
+
+    if ((ret = xd3_close_stream(&stream)) != 0) {
+        std::cerr << "xdelta3 close failed: "
+                  << (stream.msg ? stream.msg : xd3_strerror(ret)) << "\n";
+        consumed = -1;
+    }
+
+done:
+    xd3_free_stream(&stream);
+    if (fclose(out) != 0) {
+        consumed = -1;
+    }
+    fclose(in);
+    unmapFile(&src.file);
+    return consumed;
+}
+
+static int runTimed(bool is_encode, const std::string& base,
+                    const std::string& in, const std::string& out,
+                    const StreamOptions& options) {
+    uint64_t out_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    int64_t in_bytes = runStream(is_encode, base, in, out, options, &out_bytes);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (in_bytes < 0) {
+        return 1;
+    }
+    report(is_encode ? "encode" : "decode", in_bytes, out_bytes,
+           is_encode ? in_bytes : out_bytes, elapsed.count());
+    return 0;
+}
+
+static bool sameContents(const std::string& a, const std::string& b) {
+    MappedFile fa, fb;
+    bool same = mapFile(a, &fa) && mapFile(b, &fb) && fa.size == fb.size &&
+                memcmp(fa.data, fb.data, fa.size) == 0;
+    unmapFile(&fa);
+    unmapFile(&fb);
+    return same;
+}
+
+static int sweep(const std::string& base, const std::string& target,
+                 const StreamOptions& options) {
+    std::string delta = options.tmp_dir + "/xdelta_stream.delta";
+    std::string decoded = options.tmp_dir + "/xdelta_stream.decoded";
+    std::cout << "window_bytes,delta_bytes,encode_mbps,encode_peak_rss_mb,"
+                 "decode_mbps,decode_peak_rss_mb,verified\n";
+    for (uint64_t window : options.windows) {
+        StreamOptions run = options;
+        run.window = window;
+        uint64_t target_bytes = 0, delta_bytes = 0, decoded_bytes = 0;
+        double enc_rss = 0.0, dec_rss = 0.0;
+
+        // The children report their timings through a pipe.
+        int fds[2];
+        if (pipe(fds) != 0) {
+            return 1;
+        }
+        auto timed = [&](bool is_encode, const std::string& in,
+                         const std::string& out) {
+            return [&, is_encode, in, out]() {
+                uint64_t out_bytes = 0;
+                auto start = std::chrono::steady_clock::now();
+                int64_t in_bytes =
+                    runStream(is_encode, base, in, out, run, &out_bytes);
+                double seconds = std::chrono::duration<double>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count();
+                double msg[3] = {static_cast<double>(in_bytes),
+                                 static_cast<double>(out_bytes), seconds};
+                ssize_t w = write(fds[1], msg, sizeof(msg));
+                return (in_bytes < 0 || w != sizeof(msg)) ? 1 : 0;
+            };
+        };
+        double enc[3] = {0}, dec[3] = {0};
+        int status = inChild(timed(true, target, delta), &enc_rss);
+        if (status == 0 && read(fds[0], enc, sizeof(enc)) == sizeof(enc)) {
+            status = inChild(timed(false, delta, decoded), &dec_rss);
+            if (status == 0 &&
+                read(fds[0], dec, sizeof(dec)) != sizeof(dec)) {
+                status = 1;
+            }
+        }
+        close(fds[0]);
+        close(fds[1]);
+        if (status != 0) {
+            std::cerr << "window " << window << " failed\n";
+            return 1;
+        }
+        target_bytes = static_cast<uint64_t>(enc[0]);
+        delta_bytes = static_cast<uint64_t>(enc[1]);
+        decoded_bytes = static_cast<uint64_t>(dec[1]);
+        bool verified =
+            decoded_bytes == target_bytes && sameContents(target, decoded);
+        std::cout << std::fixed << std::setprecision(1) << window << ","
+                  << delta_bytes << ","
+                  << target_bytes / (1024.0 * 1024.0) / enc[2] << ","
+                  << enc_rss << ","
+                  << target_bytes / (1024.0 * 1024.0) / dec[2] << ","
+                  << dec_rss << "," << (verified ? "yes" : "NO") << "\n";
+        if (!verified) {
+            return 1;
+        }
+    }
+    unlink(delta.c_str());
+    unlink(decoded.c_str());
+    return 0;
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " encode <base> <target> <delta> [options]\n"
+        << "       " << program << " decode <base> <delta> <output> [options]\n"
+        << "       " << program << " sweep  <base> <target> [options]\n\n"
+        << "Options:\n"
+        << "  -w, --window <size>         Target window (default: 8M, max 64M)\n"
+        << "  -b, --block <size>          Source block (default: 1M)\n"
+        << "  -s, --source-window <size>  Base bytes searched around the "
+           "target position (default: 64M)\n"
+        << "  -l, --level <1-9>           xdelta3 compression level "
+           "(default: 1)\n"
+        << "  -W, --windows <a,b,...>     Window sizes for sweep (default: "
+           "256K,1M,4M,16M,64M)\n"
+        << "  -T, --tmp-dir <path>        Scratch directory for sweep "
+           "(default: /tmp)\n"
+        << "  -h, --help                  Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "-h" ||
+        std::string(argv[1]) == "--help") {
+        printUsage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+    std::string mode = argv[1];
+    size_t files = mode == "sweep" ? 2 : 3;
+    if ((mode != "encode" && mode != "decode" && mode != "sweep") ||
+        static_cast<size_t>(argc) < 2 + files) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::vector<std::string> paths(argv + 2, argv + 2 + files);
+
+    StreamOptions options;
+    for (int i = 2 + static_cast<int>(files); i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "-w" || arg == "--window") {
+            ok = parseSize(value, &options.window);
+        } else if (arg == "-b" || arg == "--block") {
+            ok = parseSize(value, &options.block);
+        } else if (arg == "-s" || arg == "--source-window") {
+            ok = parseSize(value, &options.source_window);
+        } else if (arg == "-l" || arg == "--level") {
+            options.level = std::atoi(value.c_str());
+            ok = options.level >= 1 && options.level <= 9;
+        } else if (arg == "-W" || arg == "--windows") {
+            options.windows.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (ok && std::getline(ss, item, ',')) {
+                uint64_t size = 0;
+                ok = parseSize(item, &size);
+                options.windows.push_back(size);
+            }
+        } else if (arg == "-T" || arg == "--tmp-dir") {
+            options.tmp_dir = value;
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    if (mode == "sweep") {
+        return sweep(paths[0], paths[1], options);
+    }
+    return runTimed(mode == "encode", paths[0], paths[1], paths[2], options);
+}
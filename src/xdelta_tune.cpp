@@ -0,0 +1,295 @@
+// Sweeps xdelta3's string-matcher parameters over a dataset.
+//
+// Every pair of <dataset>/meta/delta_map.csv is loaded into memory once,
+// then each parameter combination encodes all of them through the soft
+// matcher (XD3_SMATCH_SOFT) and reports the total delta size and the
+// encode throughput. The built-in matchers run first as reference points.
+// The soft matcher reads its parameters at run time, so it is somewhat
+// slower than a compiled profile with the same values; compare sizes
+// across rows freely but treat its throughput as relative.
+//
+// Output is CSV on stdout followed by the size/throughput Pareto front.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xdelta3.h"
+
+namespace fs = std::filesystem;
+
+struct Pair {
+    std::vector<uint8_t> base;
+    std::vector<uint8_t> target;
+};
+
+struct TuneOptions {
+    std::string dataset = "linux";
+    fs::path path_prefix = "/data/";
+    uint64_t total_chunks = 1000;
+    int reps = 3;
+    std::vector<usize_t> large_look = {9, 12, 16};
+    std::vector<usize_t> large_step = {3, 8, 15, 26};
+    std::vector<usize_t> small_look = {4, 6};
+    std::vector<usize_t> small_chain = {1, 2, 4, 8};
+    std::vector<usize_t> small_lchain = {1, 2};
+    std::vector<usize_t> max_lazy = {6, 18, 36};
+    std::vector<usize_t> long_enough = {6, 18, 35, 70};
+};
+
+struct Result {
+    std::string name;
+    uint64_t delta_bytes;
+    double mbps;
+};
+
+static bool readFile(const fs::path& path, std::vector<uint8_t>* out) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        std::cerr << "Failed to open " << path << "\n";
+        return false;
+    }
+    out->resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(out->data()),
+            static_cast<std::streamsize>(out->size()));
+    return true;
+}
+
+static bool loadPairs(const TuneOptions& options, std::vector<Pair>* pairs) {
+    fs::path root = options.path_prefix / options.dataset;
+    std::ifstream map_file(root / "meta/delta_map.csv");
+    if (!map_file) {
+        std::cerr << "Failed to open delta map in " << root << "\n";
+        return false;
+    }
+    std::string line;
+    std::getline(map_file, line);
+    while (pairs->size() < options.total_chunks &&
+           std::getline(map_file, line)) {
+        std::istringstream ss(line);
+        std::string delta_id, original_hash, base_hash;
+        std::getline(ss, delta_id, ',');
+        std::getline(ss, original_hash, ',');
+        std::getline(ss, base_hash, ',');
+        Pair pair;
+        if (!readFile(root / "chunks" / base_hash, &pair.base) ||
+            !readFile(root / "chunks" / original_hash, &pair.target)) {
+            continue;
+        }
+        pairs->push_back(std::move(pair));
+    }
+    return !pairs->empty();
+}
+
+// Encodes every pair `reps` times and keeps the fastest pass.
+static Result run(const std::string& name, const std::vector<Pair>& pairs,
+                  xd3_memctx* ctx, int flags, int reps, uint64_t input_bytes) {
+    std::vector<uint8_t> out(1 << 20);
+    double best = 0.0;
+    uint64_t delta_bytes = 0;
+    for (int r = 0; r < reps; ++r) {
+        delta_bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Pair& pair : pairs) {
+            usize_t out_size = 0;
+            if (xd3_encode_memory_ctx(ctx, pair.target.data(),
+                                      pair.target.size(), pair.base.data(),
+                                      pair.base.size(), out.data(), &out_size,
+                                      out.size(), flags) != 0) {
+                // Count a failed encode as a raw copy.
+                out_size = pair.target.size();
+            }
+            delta_bytes += out_size;
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    double mbps = input_bytes / (1024.0 * 1024.0) / best;
+    return Result{name, delta_bytes, mbps};
+}
+
+static void printRow(const Result& result, uint64_t input_bytes) {
+    std::cout << result.name << "," << result.delta_bytes << ","
+              << std::fixed << std::setprecision(3)
+              << static_cast<double>(input_bytes) / result.delta_bytes << ","
+              << std::setprecision(1) << result.mbps << "\n";
+    std::cout.flush();
+}
+
+static bool parseList(const std::string& text, std::vector<usize_t>* out) {
+    out->clear();
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char* end = nullptr;
+        unsigned long value = std::strtoul(item.c_str(), &end, 10);
+        if (end == item.c_str() || *end != '\0' || value == 0) {
+            return false;
+        }
+        out->push_back(static_cast<usize_t>(value));
+    }
+    return !out->empty();
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " [options]\n\n"
+        << "Options:\n"
+        << "  -d, --dataset <name>        Dataset name (default: linux)\n"
+        << "  -p, --path-prefix <path>    Dataset root path (default: /data/)\n"
+        << "  -c, --chunks <count>        Max pairs to load (default: 1000)\n"
+        << "  -r, --reps <count>          Passes per setting, best is kept "
+           "(default: 3)\n"
+        << "      --large-look <list>     Source checksum width (default: "
+           "9,12,16)\n"
+        << "      --large-step <list>     Source checksum step (default: "
+           "3,8,15,26)\n"
+        << "      --small-look <list>     Target checksum width (default: 4,6)\n"
+        << "      --small-chain <list>    Target chain length (default: "
+           "1,2,4,8)\n"
+        << "      --small-lchain <list>   Chain length after a lazy match "
+           "(default: 1,2)\n"
+        << "      --max-lazy <list>       Longest match still searched "
+           "lazily (default: 6,18,36)\n"
+        << "      --long-enough <list>    Match length that ends a chain "
+           "search (default: 6,18,35,70)\n"
+        << "  -h, --help                  Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    TuneOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "-d" || arg == "--dataset") {
+            options.dataset = value;
+        } else if (arg == "-p" || arg == "--path-prefix") {
+            options.path_prefix = value;
+        } else if (arg == "-c" || arg == "--chunks") {
+            options.total_chunks = std::stoull(value);
+        } else if (arg == "-r" || arg == "--reps") {
+            options.reps = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--large-look") {
+            ok = parseList(value, &options.large_look);
+        } else if (arg == "--large-step") {
+            ok = parseList(value, &options.large_step);
+        } else if (arg == "--small-look") {
+            ok = parseList(value, &options.small_look);
+        } else if (arg == "--small-chain") {
+            ok = parseList(value, &options.small_chain);
+        } else if (arg == "--small-lchain") {
+            ok = parseList(value, &options.small_lchain);
+        } else if (arg == "--max-lazy") {
+            ok = parseList(value, &options.max_lazy);
+        } else if (arg == "--long-enough") {
+            ok = parseList(value, &options.long_enough);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<Pair> pairs;
+    if (!loadPairs(options, &pairs)) {
+        std::cerr << "No pairs loaded\n";
+        return 1;
+    }
+    uint64_t input_bytes = 0;
+    for (const Pair& pair : pairs) {
+        input_bytes += pair.target.size();
+    }
+    std::cerr << "Loaded " << pairs.size() << " pairs, " << input_bytes
+              << " target bytes\n";
+
+    xd3_memctx ctx;
+    xd3_memctx_init(&ctx);
+    std::vector<Result> results;
+    std::cout << "matcher,delta_bytes,ratio,encode_mbps\n";
+
+    const struct {
+        const char* name;
+        xd3_smatch_cfg cfg;
+        int flags;
+    } builtins[] = {
+        {"level1", XD3_SMATCH_DEFAULT, XD3_COMPLEVEL_1},
+        {"faster", XD3_SMATCH_FASTER, 0},
+        {"fast", XD3_SMATCH_FAST, 0},
+        {"default", XD3_SMATCH_DEFAULT, 0},
+        {"slow", XD3_SMATCH_SLOW, 0},
+        {"chunkfast", XD3_SMATCH_CHUNKFAST, 0},
+        {"chunkratio", XD3_SMATCH_CHUNKRATIO, 0},
+    };
+    for (const auto& builtin : builtins) {
+        ctx.smatch_cfg = builtin.cfg;
+        results.push_back(run(builtin.name, pairs, &ctx, builtin.flags,
+                              options.reps, input_bytes));
+        printRow(results.back(), input_bytes);
+    }
+
+    ctx.smatch_cfg = XD3_SMATCH_SOFT;
+    for (usize_t llook : options.large_look)
+    for (usize_t lstep : options.large_step)
+    for (usize_t slook : options.small_look)
+    for (usize_t schain : options.small_chain)
+    for (usize_t slchain : options.small_lchain)
+    for (usize_t lazy : options.max_lazy)
+    for (usize_t enough : options.long_enough) {
+        if (slchain > schain) {
+            continue;
+        }
+        xd3_smatcher& soft = ctx.smatcher_soft;
+        soft.large_look = llook;
+        soft.large_step = lstep;
+        soft.small_look = slook;
+        soft.small_chain = schain;
+        soft.small_lchain = slchain;
+        soft.max_lazy = lazy;
+        soft.long_enough = enough;
+        std::ostringstream name;
+        name << "soft:" << llook << "/" << lstep << "/" << slook << "/"
+             << schain << "/" << slchain << "/" << lazy << "/" << enough;
+        results.push_back(
+            run(name.str(), pairs, &ctx, 0, options.reps, input_bytes));
+        printRow(results.back(), input_bytes);
+    }
+    xd3_memctx_free(&ctx);
+
+    // Fastest first; a setting is on the front if nothing faster is smaller.
+    std::sort(results.begin(), results.end(),
+              [](const Result& a, const Result& b) { return a.mbps > b.mbps; });
+    std::cout << "\nPareto front "
+                 "(large_look/large_step/small_look/small_chain/"
+                 "small_lchain/max_lazy/long_enough)\n";
+    uint64_t smallest = UINT64_MAX;
+    for (const Result& result : results) {
+        if (result.delta_bytes < smallest) {
+            smallest = result.delta_bytes;
+            printRow(result, input_bytes);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,340 @@
+// Streaming zdelta through the callback API in zd_incr.h.
+//
+// The base is mmap'd, since zdelta reads the reference from memory. The
+// target (or delta) is pulled from its file and the output is written as
+// zdelta produces it, so apart from the base only the stream state and
+// two fixed-size buffers are resident, whatever the size of the target.
+//
+//   zdelta_stream encode <base> <target> <delta> [options]
+//   zdelta_stream decode <base> <delta> <output> [options]
+//   zdelta_stream sweep  <base> <target> [options]
+//
+// sweep takes prefixes of several sizes of the base and the target and
+// encodes and decodes each one both incrementally and with the one-shot
+// zd_compress/zd_uncompress, which need the whole target and delta in
+// memory. Every step runs in its own child process so that each peak RSS
+// is measured on its own. The mapped base pages zdelta has read count
+// towards RSS in both modes.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tool_util.h"
+#include "zd_incr.h"
+
+struct StreamOptions {
+    uint64_t buffer = ZD_INCR_BUFSIZE;
+    std::vector<uint64_t> sizes = {1ULL << 20, 16ULL << 20, 64ULL << 20,
+                                   256ULL << 20};
+    std::string tmp_dir = "/tmp";
+};
+
+// Reads at most `remaining` bytes of a file.
+struct FileReader {
+    FILE* file;
+    uint64_t remaining;
+};
+
+struct FileWriter {
+    FILE* file;
+    uint64_t bytes;
+};
+
+static int readPiece(voidpf opaque, Bytef* buf, uLong size, uLong* got) {
+    FileReader* reader = static_cast<FileReader*>(opaque);
+    size_t want = static_cast<size_t>(
+        std::min<uint64_t>(size, reader->remaining));
+    size_t n = want == 0 ? 0 : fread(buf, 1, want, reader->file);
+    if (n < want && ferror(reader->file)) {
+        return ZD_ERRNO;
+    }
+    reader->remaining -= n;
+    *got = static_cast<uLong>(n);
+    return ZD_OK;
+}
+
+static int writePiece(voidpf opaque, const Bytef* piece, uLong size) {
+    FileWriter* writer = static_cast<FileWriter*>(opaque);
+    if (fwrite(piece, 1, size, writer->file) != size) {
+        return ZD_ERRNO;
+    }
+    writer->bytes += size;
+    return ZD_OK;
+}
+
+// Encodes or decodes `in` into `out` against the first `base_limit`
+// bytes of the mapped base, reading at most `in_limit` bytes of `in`. The
+// one-shot path loads all of `in` and sizes its output for `target_size`
+// bytes. Returns the number of bytes read from `in`, or -1.
+static int64_t runZdelta(bool is_encode, bool incremental,
+                         const std::string& base_path,
+                         const std::string& in_path,
+                         const std::string& out_path, uint64_t base_limit,
+                         uint64_t in_limit, uint64_t target_size,
+                         const StreamOptions& options, uint64_t* out_bytes) {
+    MappedFile base;
+    if (!mapFile(base_path, &base)) {
+        return -1;
+    }
+    FILE* in = fopen(in_path.c_str(), "rb");
+    FILE* out = fopen(out_path.c_str(), "wb");
+    if (in == nullptr || out == nullptr) {
+        std::cerr << "Failed to open " << (in ? out_path : in_path) << "\n";
+        if (in) fclose(in);
+        if (out) fclose(out);
+        unmapFile(&base);
+        return -1;
+    }
+
+    const Bytef* ref = base.data;
+    uLong ref_size = static_cast<uLong>(std::min(base.size, base_limit));
+    FileReader reader{in, in_limit};
+    FileWriter writer{out, 0};
+    int status;
+    if (incremental) {
+        status = is_encode
+                     ? zd_compress_cb(ref, ref_size, readPiece, &reader,
+                                      writePiece, &writer, options.buffer)
+                     : zd_uncompress_cb(ref, ref_size, readPiece, &reader,
+                                        writePiece, &writer, options.buffer);
+    } else {
+        std::vector<uint8_t> input;
+        uint8_t piece[1 << 16];
+        uLong got = 0;
+        while ((status = readPiece(&reader, piece, sizeof(piece), &got)) ==
+                   ZD_OK &&
+               got != 0) {
+            input.insert(input.end(), piece, piece + got);
+        }
+        // Stored blocks are the worst case and add a few bytes per block.
+        uLongf out_size = static_cast<uLongf>(
+            is_encode ? input.size() + input.size() / 16 + 4096
+                      : target_size);
+        std::vector<uint8_t> output(std::max<uLongf>(out_size, 1));
+        if (status == ZD_OK) {
+            status = is_encode
+                         ? zd_compress(ref, ref_size, input.data(),
+                                       static_cast<uLong>(input.size()),
+                                       output.data(), &out_size)
+                         : zd_uncompress(ref, ref_size, output.data(),
+                                         &out_size, input.data(),
+                                         static_cast<uLong>(input.size()));
+        }
+        if (status == ZD_OK) {
+            status = writePiece(&writer, output.data(), out_size);
+        }
+    }
+
+    int64_t consumed = static_cast<int64_t>(in_limit - reader.remaining);
+    if (status != ZD_OK) {
+        std::cerr << (is_encode ? "encode" : "decode")
+                  << " error: " << status << "\n";
+        consumed = -1;
+    }
+    *out_bytes = writer.bytes;
+    if (fclose(out) != 0) {
+        consumed = -1;
+    }
+    fclose(in);
+    unmapFile(&base);
+    return consumed;
+}
+
+static int runTimed(bool is_encode, const std::string& base,
+                    const std::string& in, const std::string& out,
+                    const StreamOptions& options) {
+    uint64_t out_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    int64_t in_bytes = runZdelta(is_encode, true, base, in, out, UINT64_MAX,
+                                 UINT64_MAX, 0, options, &out_bytes);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (in_bytes < 0) {
+        return 1;
+    }
+    report(is_encode ? "encode" : "decode", in_bytes, out_bytes,
+           is_encode ? in_bytes : out_bytes, elapsed.count());
+    return 0;
+}
+
+// True if `b` holds exactly the first `size` bytes of `a`.
+static bool samePrefix(const std::string& a, const std::string& b,
+                       uint64_t size) {
+    MappedFile fa, fb;
+    bool same = mapFile(a, &fa) && mapFile(b, &fb) && fa.size >= size &&
+                fb.size == size && memcmp(fa.data, fb.data, size) == 0;
+    unmapFile(&fa);
+    unmapFile(&fb);
+    return same;
+}
+
+// One sweep step: bytes in, bytes out, seconds and peak RSS.
+struct StepResult {
+    double msg[3] = {0, 0, 0};
+    double rss_mb = 0.0;
+};
+
+// Runs against the first `size` bytes of the base; an encode also reads
+// only the first `size` bytes of the target.
+static bool runStep(bool is_encode, bool incremental, const std::string& base,
+                    const std::string& in, const std::string& out,
+                    uint64_t size, const StreamOptions& options,
+                    StepResult* result) {
+    // The child reports its timing through a pipe.
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    auto step = [&]() {
+        uint64_t out_bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        int64_t in_bytes =
+            runZdelta(is_encode, incremental, base, in, out, size,
+                      is_encode ? size : UINT64_MAX, size, options,
+                      &out_bytes);
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+        double msg[3] = {static_cast<double>(in_bytes),
+                         static_cast<double>(out_bytes), seconds};
+        ssize_t w = write(fds[1], msg, sizeof(msg));
+        return (in_bytes < 0 || w != sizeof(msg)) ? 1 : 0;
+    };
+    int status = inChild(step, &result->rss_mb);
+    bool ok = status == 0 && read(fds[0], result->msg, sizeof(result->msg)) ==
+                                 sizeof(result->msg);
+    close(fds[0]);
+    close(fds[1]);
+    return ok;
+}
+
+static int sweep(const std::string& base, const std::string& target,
+                 const StreamOptions& options) {
+    MappedFile target_file;
+    if (!mapFile(target, &target_file)) {
+        return 1;
+    }
+    uint64_t target_size = target_file.size;
+    unmapFile(&target_file);
+
+    std::string delta = options.tmp_dir + "/zdelta_stream.delta";
+    std::string delta_whole = options.tmp_dir + "/zdelta_stream.delta.whole";
+    std::string decoded = options.tmp_dir + "/zdelta_stream.decoded";
+    std::cout << "target_bytes,delta_bytes,whole_encode_rss_mb,"
+                 "incr_encode_rss_mb,whole_decode_rss_mb,incr_decode_rss_mb,"
+                 "whole_encode_mbps,incr_encode_mbps,incr_decode_mbps,"
+                 "verified\n";
+    for (uint64_t size : options.sizes) {
+        size = std::min(size, target_size);
+        StepResult enc, enc_whole, dec, dec_whole;
+        bool ok =
+            runStep(true, true, base, target, delta, size, options, &enc) &&
+            runStep(true, false, base, target, delta_whole, size, options,
+                    &enc_whole) &&
+            runStep(false, true, base, delta, decoded, size, options, &dec) &&
+            samePrefix(target, decoded, size) &&
+            runStep(false, false, base, delta, decoded, size, options,
+                    &dec_whole) &&
+            samePrefix(target, decoded, size);
+        if (!ok) {
+            std::cerr << "size " << size << " failed\n";
+            return 1;
+        }
+        bool same_delta = samePrefix(delta, delta_whole,
+                                     static_cast<uint64_t>(enc.msg[1]));
+        double mb = size / (1024.0 * 1024.0);
+        std::cout << std::fixed << std::setprecision(1) << size << ","
+                  << static_cast<uint64_t>(enc.msg[1]) << ","
+                  << enc_whole.rss_mb << "," << enc.rss_mb << ","
+                  << dec_whole.rss_mb << "," << dec.rss_mb << ","
+                  << mb / enc_whole.msg[2] << "," << mb / enc.msg[2] << ","
+                  << mb / dec.msg[2] << ","
+                  << (same_delta ? "yes" : "delta differs") << "\n";
+        if (!same_delta) {
+            return 1;
+        }
+    }
+    unlink(delta.c_str());
+    unlink(delta_whole.c_str());
+    unlink(decoded.c_str());
+    return 0;
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " encode <base> <target> <delta> [options]\n"
+        << "       " << program << " decode <base> <delta> <output> [options]\n"
+        << "       " << program << " sweep  <base> <target> [options]\n\n"
+        << "Options:\n"
+        << "  -B, --buffer <size>         Input and output buffer size "
+           "(default: 64K)\n"
+        << "  -S, --sizes <a,b,...>       Target sizes for sweep (default: "
+           "1M,16M,64M,256M)\n"
+        << "  -T, --tmp-dir <path>        Scratch directory for sweep "
+           "(default: /tmp)\n"
+        << "  -h, --help                  Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "-h" ||
+        std::string(argv[1]) == "--help") {
+        printUsage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+    std::string mode = argv[1];
+    size_t files = mode == "sweep" ? 2 : 3;
+    if ((mode != "encode" && mode != "decode" && mode != "sweep") ||
+        static_cast<size_t>(argc) < 2 + files) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::vector<std::string> paths(argv + 2, argv + 2 + files);
+
+    StreamOptions options;
+    for (int i = 2 + static_cast<int>(files); i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "-B" || arg == "--buffer") {
+            ok = parseSize(value, &options.buffer) &&
+                 options.buffer < (1ULL << 31);
+        } else if (arg == "-S" || arg == "--sizes") {
+            options.sizes.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (ok && std::getline(ss, item, ',')) {
+                uint64_t size = 0;
+                ok = parseSize(item, &size);
+                options.sizes.push_back(size);
+            }
+        } else if (arg == "-T" || arg == "--tmp-dir") {
+            options.tmp_dir = value;
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    if (mode == "sweep") {
+        return sweep(paths[0], paths[1], options);
+    }
+    return runTimed(mode == "encode", paths[0], paths[1], paths[2], options);
+}
@@ -0,0 +1,193 @@
+// Measures zdelta's ratio and speed as the chunk size grows.
+//
+// The base and the target are cut into chunks of each size in turn, chunk
+// i of the target being encoded against chunk i of the base, and every
+// pair is encoded and decoded through one reused stream. The standard
+// zdelta window is 32K, so with larger chunks more of the base falls out
+// of reach; the tool is built as zdelta_window against the standard
+// library and as zdelta_window_lw against the large window one
+// (ZD_LARGE_WINDOW), and the two CSVs compare row by row.
+//
+//   zdelta_window <base> <target> [options]
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tool_util.h"
+#include "zdlib.h"
+
+#ifdef ZD_LARGE_WINDOW
+static const char* kBuild = "large";
+#else
+static const char* kBuild = "stock";
+#endif
+
+struct WindowOptions {
+    std::vector<uint64_t> sizes = {16ULL << 10, 64ULL << 10, 256ULL << 10,
+                                   1ULL << 20,  4ULL << 20,  16ULL << 20,
+                                   64ULL << 20};
+    uint64_t limit = 256ULL << 20;
+    int reps = 1;
+};
+
+struct Result {
+    uint64_t chunks = 0;
+    uint64_t delta_bytes = 0;
+    double encode_seconds = 0.0;
+    double decode_seconds = 0.0;
+};
+
+// Encodes and decodes the first `limit` bytes of the target in chunks of
+// `size` bytes; false if a chunk fails or does not round-trip.
+static bool runSize(const MappedFile& base, const MappedFile& target,
+                    uint64_t limit, uint64_t size, Result* result) {
+    std::vector<uint8_t> delta(size + size / 4 + 4096);
+    std::vector<uint8_t> decoded(size);
+    zd_stream deflate_stream;
+    zd_stream inflate_stream;
+    memset(&deflate_stream, 0, sizeof(deflate_stream));
+    memset(&inflate_stream, 0, sizeof(inflate_stream));
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration encode_time{}, decode_time{};
+    bool ok = true;
+    *result = Result();
+    for (uint64_t offset = 0; ok && offset < limit; offset += size) {
+        uint64_t tsize = std::min(size, limit - offset);
+        uint64_t rsize =
+            offset < base.size ? std::min(size, base.size - offset) : 0;
+        const uint8_t* ref = base.data + std::min(offset, base.size);
+
+        uLongf dsize = static_cast<uLongf>(delta.size());
+        auto start = Clock::now();
+        int status = zd_compress_reuse(&deflate_stream, 0, ref, rsize,
+                                       target.data + offset, tsize,
+                                       delta.data(), &dsize);
+        auto middle = Clock::now();
+        uLongf out_size = static_cast<uLongf>(decoded.size());
+        if (status == ZD_OK) {
+            status = zd_uncompress_reuse(&inflate_stream, ref, rsize,
+                                         decoded.data(), &out_size,
+                                         delta.data(), dsize);
+        }
+        encode_time += middle - start;
+        decode_time += Clock::now() - middle;
+        ok = status == ZD_OK && out_size == tsize &&
+             memcmp(decoded.data(), target.data + offset, tsize) == 0;
+        if (!ok) {
+            std::cerr << "chunk at " << offset << " of size " << size
+                      << " failed: " << status << "\n";
+        }
+        result->chunks++;
+        result->delta_bytes += dsize;
+    }
+    if (deflate_stream.state != nullptr) {
+        zd_deflateEnd(&deflate_stream);
+    }
+    if (inflate_stream.state != nullptr) {
+        zd_inflateEnd(&inflate_stream);
+    }
+    result->encode_seconds =
+        std::chrono::duration<double>(encode_time).count();
+    result->decode_seconds =
+        std::chrono::duration<double>(decode_time).count();
+    return ok;
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "Usage: " << program << " <base> <target> [options]\n\n"
+        << "Options:\n"
+        << "  -S, --sizes <a,b,...>       Chunk sizes (default: "
+           "16K,64K,256K,1M,4M,16M,64M)\n"
+        << "  -n, --limit <size>          Target bytes to encode per size "
+           "(default: 256M)\n"
+        << "  -r, --reps <count>          Passes per size, the fastest is "
+           "kept (default: 1)\n"
+        << "  -h, --help                  Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || std::string(argv[1]) == "-h" ||
+        std::string(argv[1]) == "--help") {
+        printUsage(argv[0]);
+        return argc < 3 ? 1 : 0;
+    }
+    WindowOptions options;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "-S" || arg == "--sizes") {
+            options.sizes.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (ok && std::getline(ss, item, ',')) {
+                uint64_t size = 0;
+                ok = parseSize(item, &size) && size < (1ULL << 31);
+                options.sizes.push_back(size);
+            }
+            ok = ok && !options.sizes.empty();
+        } else if (arg == "-n" || arg == "--limit") {
+            ok = parseSize(value, &options.limit);
+        } else if (arg == "-r" || arg == "--reps") {
+            options.reps = std::max(1, std::atoi(value.c_str()));
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    MappedFile base, target;
+    if (!mapFile(argv[1], &base) || !mapFile(argv[2], &target)) {
+        return 1;
+    }
+    if (base.size == 0 || target.size == 0) {
+        std::cerr << "The base and the target must not be empty\n";
+        return 1;
+    }
+    uint64_t limit = std::min(options.limit, target.size);
+    double mb = limit / (1024.0 * 1024.0);
+
+    std::cout << "build,chunk_bytes,chunks,target_bytes,delta_bytes,ratio,"
+                 "encode_mbps,decode_mbps\n";
+    for (uint64_t size : options.sizes) {
+        Result best;
+        for (int r = 0; r < options.reps; ++r) {
+            Result result;
+            if (!runSize(base, target, limit, size, &result)) {
+                return 1;
+            }
+            if (r == 0) {
+                best = result;
+            }
+            best.encode_seconds =
+                std::min(best.encode_seconds, result.encode_seconds);
+            best.decode_seconds =
+                std::min(best.decode_seconds, result.decode_seconds);
+        }
+        std::cout << kBuild << "," << size << "," << best.chunks << ","
+                  << limit << "," << best.delta_bytes << "," << std::fixed
+                  << std::setprecision(3)
+                  << static_cast<double>(limit) / best.delta_bytes << ","
+                  << std::setprecision(1) << mb / best.encode_seconds << ","
+                  << mb / best.decode_seconds << "\n";
+        std::cout.flush();
+    }
+    return 0;
+}
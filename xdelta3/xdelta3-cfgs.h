@@ -169,3 +169,61 @@
 #undef  MAXLAZY
 #undef  LONGENOUGH
 #endif
+
+/********************************************************
+ CHUNKFAST string matcher
+
+ Tuned with xdelta_tune for 4-64 KB dedup chunks: the FAST
+ matcher without target chains.  Faster than FASTEST at
+ compression level 1 and close to FAST in size.
+ ************************************************************/
+#if XD3_BUILD_CHUNKFAST
+#define TEMPLATE      chunkfast
+#define LLOOK         9
+#define LSTEP         8
+#define SLOOK         4U
+#define SCHAIN        1
+#define SLCHAIN       1
+#define MAXLAZY       18
+#define LONGENOUGH    35
+
+#include "xdelta3.c"
+
+#undef  TEMPLATE
+#undef  LLOOK
+#undef  SLOOK
+#undef  LSTEP
+#undef  SCHAIN
+#undef  SLCHAIN
+#undef  MAXLAZY
+#undef  LONGENOUGH
+#endif
+
+/********************************************************
+ CHUNKRATIO string matcher
+
+ Tuned with xdelta_tune for 4-64 KB dedup chunks: the DEFAULT
+ matcher with a denser source index and longer chain searches.
+ Between DEFAULT and SLOW in size, faster than SLOW.
+ ************************************************************/
+#if XD3_BUILD_CHUNKRATIO
+#define TEMPLATE      chunkratio
+#define LLOOK         9
+#define LSTEP         2
+#define SLOOK         4U
+#define SCHAIN        8
+#define SLCHAIN       2
+#define MAXLAZY       36
+#define LONGENOUGH    140
+
+#include "xdelta3.c"
+
+#undef  TEMPLATE
+#undef  LLOOK
+#undef  SLOOK
+#undef  LSTEP
+#undef  SCHAIN
+#undef  SLCHAIN
+#undef  MAXLAZY
+#undef  LONGENOUGH
+#endif
@@ -265,6 +265,10 @@
 
 #include "xdelta3-internal.h"
 
+#include <time.h>
+
+#include "hugemem.h"
+
 /***********************************************************************
  STATIC CONFIGURATION
  ***********************************************************************/
@@ -445,6 +449,16 @@ least this many bytes. */
 #else
 #define IF_BUILD_DEFAULT(x)
 #endif
+#if XD3_BUILD_CHUNKFAST
+#define IF_BUILD_CHUNKFAST(x) x
+#else
+#define IF_BUILD_CHUNKFAST(x)
+#endif
+#if XD3_BUILD_CHUNKRATIO
+#define IF_BUILD_CHUNKRATIO(x) x
+#else
+#define IF_BUILD_CHUNKRATIO(x)
+#endif
 
 /* Update the run-length state */
 #define NEXTRUN(c)          \
@@ -1648,6 +1662,12 @@ int xd3_config_stream(xd3_stream *stream, xd3_config *config) {
                         break;)
         IF_BUILD_FAST(case XD3_SMATCH_FAST : *smatcher = __smatcher_fast;
                       break;)
+        IF_BUILD_CHUNKFAST(case XD3_SMATCH_CHUNKFAST
+                           : *smatcher = __smatcher_chunkfast;
+                           break;)
+        IF_BUILD_CHUNKRATIO(case XD3_SMATCH_CHUNKRATIO
+                            : *smatcher = __smatcher_chunkratio;
+                            break;)
         default:
             stream->msg = "invalid string match config type";
             return XD3_INTERNAL;
@@ -3053,7 +3073,106 @@ done:
     return (close_stream == 0) ? 0 : xd3_close_stream(stream);
 }
 
+/*********************************************************************
+ Memory context (arena allocator for the in-memory interface)
+ *********************************************************************/
+
+/* The arena and the source index tables come from hugemem, so they can
+ * sit on huge pages (see hugemem.h); the spill blocks are short-lived and
+ * stay on malloc. */
+
+#define XD3_MEMCTX_ALIGN 64
+#define XD3_MEMCTX_MIN_ARENA (1U << 20)
+
+static uint64_t xd3_memctx_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void xd3_memctx_init(xd3_memctx *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+static void xd3_memctx_free_spill(xd3_memctx *ctx) {
+    while (ctx->spill != NULL) {
+        xd3_memctx_block *next = ctx->spill->next;
+        free(ctx->spill);
+        ctx->spill = next;
+    }
+    ctx->spill_bytes = 0;
+}
+
+void xd3_memctx_free(xd3_memctx *ctx) {
+    xd3_memctx_free_spill(ctx);
+    hugemem_free(ctx->arena);
+    ctx->arena = NULL;
+    ctx->arena_size = 0;
+    ctx->arena_used = 0;
+}
+
+/* Start a new call: drop everything the previous stream allocated.  If it
+ * spilled, replace the arena by one block that holds the whole footprint. */
+static int xd3_memctx_rewind(xd3_memctx *ctx) {
+    usize_t need = ctx->arena_used + ctx->spill_bytes;
+
+    if (need > ctx->peak_bytes) {
+        ctx->peak_bytes = need;
+    }
+
+    if (ctx->spill != NULL || ctx->arena == NULL) {
+        usize_t size = xd3_max(ctx->arena_size, (usize_t)XD3_MEMCTX_MIN_ARENA);
+
+        while (size < ctx->peak_bytes) {
+            size *= 2;
+        }
+
+        xd3_memctx_free_spill(ctx);
+
+        if (size != ctx->arena_size) {
+            hugemem_free(ctx->arena);
+            ctx->arena_size = 0;
+            if ((ctx->arena = (uint8_t *)hugemem_alloc(size)) == NULL) {
+                return ENOMEM;
+            }
+            ctx->arena_size = size;
+        }
+    }
+
+    ctx->arena_used = 0;
+    return 0;
+}
+
+static void *xd3_memctx_alloc(void *opaque, size_t items, usize_t size) {
+    xd3_memctx *ctx = (xd3_memctx *)opaque;
+    size_t bytes = items * (size_t)size;
+    size_t aligned = (bytes + XD3_MEMCTX_ALIGN - 1) & ~(size_t)(XD3_MEMCTX_ALIGN - 1);
+    xd3_memctx_block *blk;
+
+    ctx->allocs += 1;
+
+    if (aligned <= ctx->arena_size - ctx->arena_used) {
+        void *p = ctx->arena + ctx->arena_used;
+        ctx->arena_used += aligned;
+        return p;
+    }
+
+    /* The header keeps the payload 64-byte aligned. */
+    if (posix_memalign((void **)&blk, XD3_MEMCTX_ALIGN,
+                       XD3_MEMCTX_ALIGN + aligned) != 0) {
+        return NULL;
+    }
+    blk->next = ctx->spill;
+    ctx->spill = blk;
+    ctx->spill_bytes += aligned;
+    return (uint8_t *)blk + XD3_MEMCTX_ALIGN;
+}
+
+static void xd3_memctx_freef(void *opaque, void *address) {
+    (void)opaque;
+    (void)address;
+}
+
 static int xd3_process_memory(int is_encode, int (*func)(xd3_stream *),
+                              xd3_memctx *ctx, const xd3_source_index *idx,
                               const uint8_t *input, usize_t input_size,
                               const uint8_t *source, usize_t source_size,
                               uint8_t *output, usize_t *output_size,
@@ -3061,6 +3180,7 @@ static int xd3_process_memory(int is_encode, int (*func)(xd3_stream *),
     xd3_stream stream;
     xd3_config config;
     xd3_source src;
+    uint64_t setup_start = 0;
     int ret;
 
     memset(&stream, 0, sizeof(stream));
@@ -3072,6 +3192,19 @@ static int xd3_process_memory(int is_encode, int (*func)(xd3_stream *),
         goto exit;
     }
 
+    if (ctx != NULL) {
+        setup_start = xd3_memctx_clock();
+        if ((ret = xd3_memctx_rewind(ctx)) != 0) {
+            stream.msg = "memory context allocation failed";
+            goto exit;
+        }
+        config.alloc = xd3_memctx_alloc;
+        config.freef = xd3_memctx_freef;
+        config.opaque = ctx;
+        config.smatch_cfg = ctx->smatch_cfg;
+        config.smatcher_soft = ctx->smatcher_soft;
+    }
+
     config.flags = flags;
 
     if (is_encode) {
@@ -3095,6 +3228,25 @@ static int xd3_process_memory(int is_encode, int (*func)(xd3_stream *),
         if ((ret = xd3_set_source_and_size(&stream, &src, source_size)) != 0) {
             goto exit;
         }
+
+        /* The whole source is already indexed: install the table and
+         * mark the checksum window finished so that
+         * xd3_srcwin_move_point() never writes to it. */
+        if (idx != NULL) {
+            if (stream.smatcher.large_look != idx->large_look ||
+                stream.smatcher.large_step != idx->large_step) {
+                stream.msg = "source index built for another matcher";
+                ret = XD3_INVALID;
+                goto exit;
+            }
+            stream.large_table = idx->large_table;
+            stream.srcwin_cksum_pos = source_size;
+        }
+    }
+
+    if (ctx != NULL) {
+        ctx->setup_ns += xd3_memctx_clock() - setup_start;
+        ctx->calls += 1;
     }
 
     if ((ret =
@@ -3107,6 +3259,9 @@ exit:
     if (ret != 0) {
         IF_DEBUG2(DP(RINT "process_memory: %d: %s\n", ret, stream.msg));
     }
+    if (idx != NULL) {
+        stream.large_table = NULL;
+    }
     xd3_free_stream(&stream);
     return ret;
 }
@@ -3122,9 +3277,19 @@ int xd3_decode_memory(const uint8_t *input, usize_t input_size,
                       const uint8_t *source, usize_t source_size,
                       uint8_t *output, usize_t *output_size,
                       usize_t output_size_max, int flags) {
-    return xd3_process_memory(0, &xd3_decode_input, input, input_size, source,
-                              source_size, output, output_size, output_size_max,
-                              flags);
+    return xd3_process_memory(0, &xd3_decode_input, NULL, NULL, input,
+                              input_size, source, source_size, output,
+                              output_size, output_size_max, flags);
+}
+
+int xd3_decode_memory_ctx(xd3_memctx *ctx, const uint8_t *input,
+                          usize_t input_size, const uint8_t *source,
+                          usize_t source_size, uint8_t *output,
+                          usize_t *output_size, usize_t output_size_max,
+                          int flags) {
+    return xd3_process_memory(0, &xd3_decode_input, ctx, NULL, input,
+                              input_size, source, source_size, output,
+                              output_size, output_size_max, flags);
 }
 
 #if XD3_ENCODER
@@ -3139,9 +3304,115 @@ int xd3_encode_memory(const uint8_t *input, usize_t input_size,
                       const uint8_t *source, usize_t source_size,
                       uint8_t *output, usize_t *output_size,
                       usize_t output_size_max, int flags) {
-    return xd3_process_memory(1, &xd3_encode_input, input, input_size, source,
-                              source_size, output, output_size, output_size_max,
-                              flags);
+    return xd3_process_memory(1, &xd3_encode_input, NULL, NULL, input,
+                              input_size, source, source_size, output,
+                              output_size, output_size_max, flags);
+}
+
+int xd3_encode_memory_ctx(xd3_memctx *ctx, const uint8_t *input,
+                          usize_t input_size, const uint8_t *source,
+                          usize_t source_size, uint8_t *output,
+                          usize_t *output_size, usize_t output_size_max,
+                          int flags) {
+    return xd3_process_memory(1, &xd3_encode_input, ctx, NULL, input,
+                              input_size, source, source_size, output,
+                              output_size, output_size_max, flags);
+}
+
+int xd3_prepare_source_index(const xd3_memctx *ctx, xd3_source_index *idx,
+                             const uint8_t *source, usize_t source_size,
+                             int flags) {
+    xd3_stream stream;
+    xd3_config config;
+    xd3_source src;
+    usize_t next_move_point;
+    int ret;
+
+    memset(idx, 0, sizeof(*idx));
+    memset(&stream, 0, sizeof(stream));
+    memset(&config, 0, sizeof(config));
+    memset(&src, 0, sizeof(src));
+
+    if (source == NULL) {
+        return XD3_INVALID;
+    }
+
+    /* Same stream and source setup as xd3_process_memory(), so the
+     * table geometry matches the encoder's. */
+    config.flags = flags;
+    config.winsize = XD3_DEFAULT_WINSIZE;
+    config.sprevsz = xd3_pow2_roundup(config.winsize);
+    if (ctx != NULL) {
+        config.smatch_cfg = ctx->smatch_cfg;
+        config.smatcher_soft = ctx->smatcher_soft;
+    }
+
+    if ((ret = xd3_config_stream(&stream, &config)) != 0) {
+        goto exit;
+    }
+
+    src.blksize = source_size;
+    src.onblk = source_size;
+    src.curblk = source;
+    src.curblkno = 0;
+    src.max_winsize = source_size;
+
+    if ((ret = xd3_set_source_and_size(&stream, &src, source_size)) != 0) {
+        goto exit;
+    }
+
+    if ((ret = xd3_size_hashtable(
+             &stream, stream.src->max_winsize / stream.smatcher.large_step,
+             stream.smatcher.large_look, &stream.large_hash)) != 0) {
+        goto exit;
+    }
+
+    if ((idx->large_table = (usize_t *)hugemem_alloc(
+             stream.large_hash.size * sizeof(usize_t))) == NULL) {
+        ret = ENOMEM;
+        goto exit;
+    }
+    memset(idx->large_table, 0, stream.large_hash.size * sizeof(usize_t));
+
+    /* At input position zero the checksum window covers the whole
+     * source, so one call indexes all of it. */
+    stream.large_table = idx->large_table;
+    ret = xd3_srcwin_move_point(&stream, &next_move_point);
+    stream.large_table = NULL;
+
+    if (ret != 0) {
+        hugemem_free(idx->large_table);
+        idx->large_table = NULL;
+        goto exit;
+    }
+
+    idx->source = source;
+    idx->source_size = source_size;
+    idx->large_look = stream.smatcher.large_look;
+    idx->large_step = stream.smatcher.large_step;
+    idx->large_size = stream.large_hash.size;
+
+exit:
+    xd3_free_stream(&stream);
+    return ret;
+}
+
+void xd3_free_source_index(xd3_source_index *idx) {
+    hugemem_free(idx->large_table);
+    memset(idx, 0, sizeof(*idx));
+}
+
+int xd3_encode_memory_indexed(xd3_memctx *ctx, const xd3_source_index *idx,
+                              const uint8_t *input, usize_t input_size,
+                              uint8_t *output, usize_t *output_size,
+                              usize_t output_size_max, int flags) {
+    if (idx->large_table == NULL) {
+        return XD3_INVALID;
+    }
+
+    return xd3_process_memory(1, &xd3_encode_input, ctx, idx, input,
+                              input_size, idx->source, idx->source_size,
+                              output, output_size, output_size_max, flags);
 }
 #endif
 
@@ -319,6 +319,12 @@ typedef uint32_t usize_t;
 #ifndef XD3_BUILD_DEFAULT
 #define XD3_BUILD_DEFAULT 1
 #endif
+#ifndef XD3_BUILD_CHUNKFAST
+#define XD3_BUILD_CHUNKFAST 1
+#endif
+#ifndef XD3_BUILD_CHUNKRATIO
+#define XD3_BUILD_CHUNKRATIO 1
+#endif
 
 #if XD3_DEBUG
 #include <stdio.h>
@@ -519,7 +525,9 @@ typedef enum
   XD3_SMATCH_FAST    = 2,
   XD3_SMATCH_FASTER  = 3,
   XD3_SMATCH_FASTEST = 4,
-  XD3_SMATCH_SOFT    = 5
+  XD3_SMATCH_SOFT    = 5,
+  XD3_SMATCH_CHUNKFAST  = 6, /* Tuned for small chunks, see xdelta3-cfgs.h */
+  XD3_SMATCH_CHUNKRATIO = 7
 } xd3_smatch_cfg;
 
 /*********************************************************************
@@ -1102,6 +1110,66 @@ struct _xd3_stream
 #endif
 };
 
+/* Persistent context for xd3_encode_memory_ctx / xd3_decode_memory_ctx.
+ * xd3_encode_memory() builds a stream on the stack and mallocs its
+ * hash tables, instruction buffers and section buffers for every call.
+ * A memctx keeps one arena that the stream allocates from through the
+ * xd3_config alloc hooks; frees are no-ops and the arena is rewound at
+ * the start of the next call, so after the first few chunks a call does
+ * no heap allocation at all.  When a call outgrows the arena the extra
+ * memory is taken from spill blocks, which are folded into one larger
+ * arena on the next rewind.
+ *
+ * setup_ns accumulates the time spent configuring the stream and
+ * installing the source (everything before the first input byte is
+ * processed), calls counts the chunks it covers. */
+typedef struct _xd3_memctx_block xd3_memctx_block;
+
+struct _xd3_memctx_block
+{
+  xd3_memctx_block *next;
+};
+
+typedef struct _xd3_memctx xd3_memctx;
+
+struct _xd3_memctx
+{
+  uint8_t          *arena;        /* main block, 64-byte aligned */
+  usize_t           arena_size;
+  usize_t           arena_used;
+  xd3_memctx_block *spill;        /* overflow blocks of the current call */
+  usize_t           spill_bytes;  /* bytes requested from the spill blocks */
+  usize_t           peak_bytes;   /* largest footprint of a single call */
+
+  /* String matcher for every stream of this context.  The default
+   * (XD3_SMATCH_DEFAULT) picks one from the flags' compression level;
+   * smatcher_soft is used with XD3_SMATCH_SOFT. */
+  xd3_smatch_cfg    smatch_cfg;
+  xd3_smatcher      smatcher_soft;
+
+  uint64_t          setup_ns;     /* total stream setup time */
+  uint64_t          calls;        /* encode/decode calls */
+  uint64_t          allocs;       /* allocations served */
+};
+
+/* A source checksum index (the encoder's large_table) built once by
+ * xd3_prepare_source_index() and shared by any number of
+ * xd3_encode_memory_indexed() calls against the same source.  The
+ * table is read-only while encoding.  It is only valid for string
+ * matchers with the same large checksum width and step as the one it
+ * was built with. */
+typedef struct _xd3_source_index xd3_source_index;
+
+struct _xd3_source_index
+{
+  const uint8_t *source;
+  usize_t        source_size;
+  usize_t        large_look;
+  usize_t        large_step;
+  usize_t       *large_table;
+  usize_t        large_size;   /* entries in large_table */
+};
+
 /**************************************************************************
  PUBLIC FUNCTIONS
  **************************************************************************/
@@ -1134,6 +1202,59 @@ int     xd3_decode_memory (const uint8_t *input,
 			   usize_t        avail_output,
 			   int            flags);
 
+/* Same as xd3_encode_memory / xd3_decode_memory, but every call
+ * allocates from CTX instead of the heap.  CTX must be zeroed with
+ * xd3_memctx_init() before the first call and released with
+ * xd3_memctx_free(). */
+void    xd3_memctx_init (xd3_memctx *ctx);
+void    xd3_memctx_free (xd3_memctx *ctx);
+
+int     xd3_encode_memory_ctx (xd3_memctx    *ctx,
+			       const uint8_t *input,
+			       usize_t        input_size,
+			       const uint8_t *source,
+			       usize_t        source_size,
+			       uint8_t       *output_buffer,
+			       usize_t       *output_size,
+			       usize_t        avail_output,
+			       int            flags);
+
+int     xd3_decode_memory_ctx (xd3_memctx    *ctx,
+			       const uint8_t *input,
+			       usize_t        input_size,
+			       const uint8_t *source,
+			       usize_t        source_size,
+			       uint8_t       *output_buf,
+			       usize_t       *output_size,
+			       usize_t        avail_output,
+			       int            flags);
+
+/* Index all of SOURCE once, for use by xd3_encode_memory_indexed().
+ * SOURCE is referenced, not copied, and must outlive the index.  The
+ * string matcher is the one CTX (which may be NULL) and FLAGS select;
+ * CTX itself is not allocated from. */
+int     xd3_prepare_source_index (const xd3_memctx *ctx,
+				  xd3_source_index *idx,
+				  const uint8_t    *source,
+				  usize_t           source_size,
+				  int               flags);
+void    xd3_free_source_index (xd3_source_index *idx);
+
+/* xd3_encode_memory_ctx() against a prepared source: the source is not
+ * re-indexed.  A per-call encode skips indexing the source prefix that
+ * the target starts with, the prepared index covers it, so deltas of
+ * targets that share a prefix with the source can differ (they remain
+ * valid for xd3_decode_memory).  Returns XD3_INVALID if CTX and
+ * FLAGS select a matcher the index was not prepared for. */
+int     xd3_encode_memory_indexed (xd3_memctx             *ctx,
+				   const xd3_source_index *idx,
+				   const uint8_t          *input,
+				   usize_t                 input_size,
+				   uint8_t                *output_buffer,
+				   usize_t                *output_size,
+				   usize_t                 avail_output,
+				   int                     flags);
+
 /* This function encodes an in-memory input using a pre-configured
  * xd3_stream.  This allows the caller to set a variety of options
  * which are not available in the xd3_encode/decode_memory()
@@ -82,6 +82,10 @@
 
 #include "deflate.h"
 #include <limits.h>
+#include "isa.h"
+#if defined(DELTA_ISA_X86)
+#  include <immintrin.h>
+#endif
 
 
 
@@ -114,6 +118,10 @@ local void fill_ref_window OF((deflate_state *s, int rw)); /* zdelta: added  */
 local void lm_init         OF((deflate_state *s)); /* zdelta: modified */
 local void init_window     OF((deflate_state *s)); /* zdelta: added    */
 local void init_ref_window OF((deflate_state *s, int rw)); /* zdelta: added  */
+local int  deflate_reset   OF((zd_streamp strm, int keep_ref)); /* zdelta: added */
+#ifdef ZD_LARGE_WINDOW
+local int  auto_window_bits OF((zd_streamp strm));           /* zdelta: added */
+#endif
 
 local block_state deflate_stored OF((deflate_state *s, int flush));
 /* zdelta: added    */
@@ -186,8 +194,13 @@ local const config configuration_table[10] = {
 
 /*         reference sliding window      */
 #define ZD_TIME_TO_CHECK  2
-#define ZD_HIST_SIZE      1000
 #define ZD_GET_NEXT_POS(ind)(++ind == ZD_HIST_SIZE?0:ind)
+#ifdef ZD_LARGE_WINDOW
+/* slide once the matches average this close to the window end */
+#  define ZD_SLIDE_POS(s) (((ulg)(s)->w_size * 22000) >> 15)
+#else
+#  define ZD_SLIDE_POS(s) 22000
+#endif
 
 struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
 
@@ -251,6 +264,29 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 int ZEXPORT zd_deflateReset (strm)
     zd_streamp strm;
+{
+  return deflate_reset(strm, 0);
+}
+
+/* ========================================================================= */
+/* zdelta: added
+ *         same as zd_deflateReset, but a reference that is unchanged since
+ *         the previous target and fit in the reference window keeps its
+ *         window and hash chains instead of being read and hashed again
+ */
+int ZEXPORT zd_deflateResetKeepRef (strm)
+    zd_streamp strm;
+{
+  return deflate_reset(strm, 1);
+}
+
+/* ========================================================================= */
+/* zdelta: added
+ *         common part of zd_deflateReset and zd_deflateResetKeepRef
+ */
+local int deflate_reset (strm, keep_ref)
+    zd_streamp strm;
+    int keep_ref;
 {
   deflate_state *s;
   int rw;
@@ -259,6 +295,14 @@ int ZEXPORT zd_deflateReset (strm)
       strm->zalloc == ZD_NULL || strm->zfree == ZD_NULL ||
       strm->refnum < 0 || strm->refnum > REFNUM) return ZD_STREAM_ERROR;
 
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: the window zd_deflateInit sized for earlier inputs is too
+   *         small for these; the caller starts over with a new stream
+   */
+  s = (deflate_state *)strm->state;
+  if (s->w_auto && auto_window_bits(strm) > s->w_bits) return ZD_BUF_ERROR;
+#endif
+
   strm->total_in = strm->total_out = 0;
   for(rw=0;rw<strm->refnum;++rw) strm->base_out[rw] = 0;
 
@@ -284,7 +328,23 @@ int ZEXPORT zd_deflateReset (strm)
    *         into the reference dictionary 
    */
   for(rw=0;rw<strm->refnum;++rw){
-    if(strm->base_avail[rw] >= MIN_MATCH)  init_ref_window(s,rw);
+    if(keep_ref && s->ref_kept[rw] != 0 &&
+       s->ref_kept[rw] == strm->base_avail[rw]){
+      /* zdelta: same bookkeeping as the read in init_ref_window */
+      s->ref_window_size[rw] = s->ref_kept[rw];
+      strm->base[rw]        += s->ref_kept[rw];
+      strm->base_out[rw]     = s->ref_kept[rw];
+      strm->base_avail[rw]   = 0;
+    }
+    else if(strm->base_avail[rw] >= MIN_MATCH){
+      init_ref_window(s,rw);
+    }
+    else{
+      /* zdelta: no usable reference; leave it as zd_deflateInit did */
+      CLEAR_REF_HASH(s,rw);
+      zmemzero(s->ref_window[rw], (unsigned)(2*s->w_size));
+      s->ref_kept[rw] = 0;
+    }
   }
 
   /* zdelta: initialize the target hash table here;
@@ -294,6 +354,8 @@ int ZEXPORT zd_deflateReset (strm)
   
   if (strm->avail_in >= MIN_MATCH) 
     init_window(s);
+  else
+    zmemzero(s->window, (unsigned)s->window_size);
   
   return ZD_OK;
 }
@@ -345,11 +407,41 @@ int ZEXPORT zd_deflateInit_(strm, level, version, stream_size)
     const char *version;
     int stream_size;
 {
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: size the window to the inputs instead of always taking 16M */
+  int err = zd_deflateInit2_(strm, level, ZD_DEFLATED, 
+			     auto_window_bits(strm), DEF_MEM_LEVEL, 
+			     ZD_DEFAULT_STRATEGY, version, stream_size);
+  if (err == ZD_OK) ((deflate_state *)strm->state)->w_auto = 1;
+  return err;
+#else
   return zd_deflateInit2_(strm, level, ZD_DEFLATED, MAX_WBITS, 
 			  DEF_MEM_LEVEL, ZD_DEFAULT_STRATEGY, version, 
 			  stream_size);
     /* To do: ignore strm->next_in if we use it as window */
+#endif
+}
+
+#ifdef ZD_LARGE_WINDOW
+/* ========================================================================= */
+/* zdelta: added
+ * windowBits of a window that holds the whole target and each reference,
+ * so that no copy is out of reach; never below the standard 32K window
+ */
+local int auto_window_bits(strm)
+    zd_streamp strm;
+{
+  ulg need = strm->avail_in;
+  int bits = 15;
+  int rw;
+
+  for(rw=0; rw<strm->refnum && rw<REFNUM; ++rw){
+    if(strm->base_avail[rw] > need) need = strm->base_avail[rw];
+  }
+  while(bits < MAX_WBITS && ((ulg)1 << bits) < need) bits++;
+  return bits;
 }
+#endif
 
 /* ========================================================================= */
 /* zdelta: modified
@@ -406,7 +498,8 @@ int ZEXPORT zd_deflateInit2_(strm, level, method, windowBits, memLevel,
 #endif
 
   if (memLevel < 1 || memLevel > MAX_MEM_LEVEL || method != ZD_DEFLATED ||
-      windowBits < 8 || windowBits > 15 || level < 0 || level > 9 ||
+      windowBits < WBITS_BASE || windowBits > MAX_WBITS || 
+      level < 0 || level > 9 ||
       strategy < ZD_HUFFMAN_ONLY || strategy > 8 || 
       refnum < 0 || refnum > REFNUM)
   {
@@ -420,11 +513,21 @@ int ZEXPORT zd_deflateInit2_(strm, level, method, windowBits, memLevel,
   s->strm = strm;
 
   s->noheader = noheader;
+#ifdef ZD_LARGE_WINDOW
+  s->w_auto = 0;
+#endif
   s->w_bits = windowBits;
   s->w_size = 1 << s->w_bits;
   s->w_mask = s->w_size - 1;
 
   s->hash_bits  = memLevel + 7;
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: grow the hash with the window, or the chains over a large
+   * reference get too long to be walked within max_chain
+   */
+  if (s->hash_bits < (uInt)windowBits)
+    s->hash_bits = windowBits < ZD_MAX_HASH_BITS ? windowBits : ZD_MAX_HASH_BITS;
+#endif
   s->hash_size  = 1 << s->hash_bits;
   s->hash_mask  = s->hash_size - 1;
   s->hash_shift =  ((s->hash_bits+MIN_MATCH-1)/MIN_MATCH);
@@ -445,9 +548,21 @@ int ZEXPORT zd_deflateInit2_(strm, level, method, windowBits, memLevel,
 
   s->lit_bufsize = 1 << (memLevel + 6); /* 16K elements by default */
 
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: no overlay here. A distance takes up to 15+22 bits, so a
+   * literal/length/zdelta code triple up to 77; 12 bytes per symbol hold
+   * a full block and its header in pending_buf, followed by d_buf, l_buf
+   * and z_buf
+   */
+  overlay = (ushf *) ZALLOC(strm, s->lit_bufsize, 
+			    12+sizeof(Dist)+sizeof(ush)+1);
+  s->pending_buf = (uchf *) overlay;
+  s->pending_buf_size = (ulg)s->lit_bufsize * 12L;
+#else
   overlay = (ushf *) ZALLOC(strm, s->lit_bufsize, 2*sizeof(ush)+2);
   s->pending_buf = (uchf *) overlay;
   s->pending_buf_size = (ulg)s->lit_bufsize * (sizeof(ush)+2L);
+#endif
 
   if (s->ref_window[0] == ZD_NULL || s->prev        == ZD_NULL ||
       s->head          == ZD_NULL || s->ref_prev[0] == ZD_NULL ||
@@ -458,9 +573,15 @@ int ZEXPORT zd_deflateInit2_(strm, level, method, windowBits, memLevel,
     return ZD_MEM_ERROR;
   }
 
+#ifdef ZD_LARGE_WINDOW
+  s->d_buf = (Distf *) (s->pending_buf + s->pending_buf_size);
+  s->l_buf = (ushf *) (s->d_buf + s->lit_bufsize);
+  s->z_buf = (uchf *) (s->l_buf + s->lit_bufsize);
+#else
   s->d_buf = overlay + s->lit_bufsize/sizeof(ush);
   s->l_buf = s->d_buf + s->lit_bufsize;
   s->z_buf = s->pending_buf + (1+2*sizeof(ush))*s->lit_bufsize;
+#endif
 
   /* zdelta: initialize reference window buffers */
   for(i=1;i<refnum;++i){
@@ -552,7 +673,7 @@ int ZEXPORT zd_deflate (strm, flush)
   /* Write the libzd header */
   if (s->status == INIT_STATE) {
 
-    uInt header = (ZD_DEFLATED + ((s->w_bits-8)<<4)) << 8;
+    uInt header = (ZD_DEFLATED + ((s->w_bits-WBITS_BASE)<<4)) << 8;
     uInt level_flags = (s->level-1) >> 1;
 
     if (level_flags > 3) level_flags = 3;
@@ -762,6 +883,13 @@ local void lm_init (s)
   s->match_available = 0;
   s->ins_h = 0;
   s->match_benefit   = s->prev_benefit = 0;
+  s->match_start = s->prev_match = 0;
+  s->match_ptr = s->prev_ptr = 0;
+  s->match_sign = s->prev_sign = 0;
+  s->match_distance = s->prev_distance = 0;
+
+  /* zdelta: a reset stream must start from the same state as a new one */
+  CLEAR_HASH(s);
 
   /* Set the default configuration parameters:
    */
@@ -778,6 +906,8 @@ local void lm_init (s)
   for(i=0; i<refnum; ++i){
     s->stored_allowed[i] = 1;
     s->ref_window_size[i]  = (ulg)2L*s->w_size;
+    s->ph.sum_len[i]   = s->ph.sum_ptr[i]  = 0;
+    s->ph.front_ptr[i] = s->ph.back_ptr[i] = s->ph.ch_flag[i] = 0;
   }
 
 }
@@ -916,8 +1046,8 @@ fill_ref_window(s, rw)
    * it will never be used again; stop updating it
    * TODO: needs better solution for this
    */ 
-  if(s->rwptr[2*rw]  > (- ZD_UNREACHABLE)) s->rwptr[2*rw]   -=wsize;
-  if(s->rwptr[2*rw+1]> (- ZD_UNREACHABLE)) s->rwptr[2*rw+1] -=wsize;
+  if(s->rwptr[2*rw]  > (- ZD_REACH(s))) s->rwptr[2*rw]   -=wsize;
+  if(s->rwptr[2*rw+1]> (- ZD_REACH(s))) s->rwptr[2*rw+1] -=wsize;
   
   /* zdelta: flush reference dictionary 	 */
   CLEAR_REF_HASH(s, rw);
@@ -931,6 +1061,7 @@ fill_ref_window(s, rw)
     INSERT_REF_STRING(s,i,rw);
   }
   s->stored_allowed[rw] = 0;
+  s->ref_kept[rw] = 0;
 }
 
 /* zdelta:added
@@ -945,7 +1076,10 @@ init_ref_window(s, rw)
     uInt n;
 
     n = read_ref_buf(s->strm, s->ref_window[rw], s->ref_window_size[rw], rw);
+    /* zdelta: the tail may hold a previous reference of a reset stream */
+    zmemzero(s->ref_window[rw] + n, (unsigned)(s->ref_window_size[rw] - n));
     s->ref_window_size[rw] = n;
+    s->ref_kept[rw] = s->strm->base_avail[rw] == 0 ? n : 0;
     /* clear memory */
     CLEAR_REF_HASH(s,rw);	
     
@@ -974,6 +1108,9 @@ init_window(s)
 {
 
     s->lookahead = read_buf(s->strm, s->window, (unsigned) s->window_size);
+    /* zdelta: the tail may hold a previous target of a reset stream */
+    zmemzero(s->window + s->lookahead,
+             (unsigned)(s->window_size - s->lookahead));
 
     /* zdelta: Initialize the hash value now that we have some input: */
     if (s->lookahead >= MIN_MATCH) {
@@ -1022,6 +1159,42 @@ init_window(s)
 }
 
 
+/* zdelta: added
+ * length of the match at scan/match, with the same result and reads as the
+ * unrolled byte loop in the *_longest_match functions: bytes 0 and 1 were
+ * checked by the caller, byte 2 is implied by the hash, and bytes 3 to
+ * MAX_MATCH are compared 32 at a time
+ */
+#if defined(DELTA_ISA_X86)
+DELTA_TARGET_AVX2 local uInt match_len_avx2(const Bytef *scan, const Bytef *match)
+{
+  uInt i;
+
+  for(i = 3; i < MAX_MATCH; i += 32){
+    __m256i a = _mm256_loadu_si256((const __m256i *)(scan + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(match + i));
+    unsigned int ne = ~(unsigned int)
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+    if(ne){
+      i += (uInt)__builtin_ctz(ne);
+      return i < MAX_MATCH ? i : MAX_MATCH;
+    }
+  }
+  return MAX_MATCH;
+}
+#endif
+
+/* zdelta: added
+ * fetch the window bytes of the next chain candidate while the current
+ * one is compared
+ */
+#if defined(__GNUC__)
+#  define PREFETCH_MATCH(p) __builtin_prefetch((p), 0, 3)
+#else
+#  define PREFETCH_MATCH(p)
+#endif
+
+
 /* ===========================================================================
  * zdelta: added
  * locates the best match in the reference data
@@ -1094,8 +1267,8 @@ local void reference_longest_match(s, cur_match, rw)
   }
   mid = min >= 0 ? (max + min) / 2 : 0;
   
-  limit = min >  ZD_UNREACHABLE ? (Pos) (min - ZD_UNREACHABLE) : NIL;
-  while(cur_match > (IPos) max + ZD_UNREACHABLE) 
+  limit = min >  ZD_REACH(s) ? (Pos) (min - ZD_REACH(s)) : NIL;
+  while(cur_match > (IPos) max + ZD_REACH(s)) 
     cur_match = prev[cur_match & wmask];
   if(cur_match == NIL) return;
   
@@ -1110,6 +1283,7 @@ local void reference_longest_match(s, cur_match, rw)
 
   do {
     match = s->ref_window[rw] + cur_match; 
+    PREFETCH_MATCH(s->ref_window[rw] + prev[cur_match & wmask]);
     
     /* Skip to next match if the match length cannot increase
      * or if the match length is less than 2:
@@ -1127,8 +1301,14 @@ local void reference_longest_match(s, cur_match, rw)
       cur_ptr = min_ptr;
       cur_distance = ZD_DISTANCE((IPos)min,cur_match);
     }
-    if(cur_distance >= ZD_UNREACHABLE) continue;
+    if(cur_distance >= ZD_REACH(s)) continue;
     
+#if defined(DELTA_ISA_X86)
+    if(delta_isa >= DELTA_ISA_AVX2)
+      len = match_len_avx2(scan, s->ref_window[rw] + cur_match);
+    else
+#endif
+    {
     /* The check at best_len-1 can be removed because it will be made
      * again later. (This heuristic is not always a win.)
      * It is not necessary to compare scan[2] and match[2] since they
@@ -1152,6 +1332,7 @@ local void reference_longest_match(s, cur_match, rw)
 
     len     = MAX_MATCH - (int)(strend - scan);
     scan    = strend - MAX_MATCH;
+    }
 
     /* Do not look for matches beyond the end of the input. This is necessary
      * to make deflate deterministic.
@@ -1230,8 +1411,8 @@ local void target_longest_match(s, cur_match)
   Assert((ulg)s->strstart <= s->window_size-MIN_LOOKAHEAD, "need lookahead");
   Assert(cur_match < s->strstart, "no future");
 
-  limit = s->strstart > (IPos)ZD_UNREACHABLE ? 
-    s->strstart - ((IPos) ZD_UNREACHABLE) : NIL;
+  limit = s->strstart > (IPos)ZD_REACH(s) ? 
+    s->strstart - ((IPos) ZD_REACH(s)) : NIL;
     
   /* Do not waste too much time if we already have a good match: */
   if (best_len >= s->good_match) {
@@ -1244,6 +1425,7 @@ local void target_longest_match(s, cur_match)
 
   do {
     match = s->window + cur_match;
+    PREFETCH_MATCH(s->window + prev[cur_match & wmask]);
     /* Skip to next match if the match length cannot increase
      * or if the match length is less than 2:
      */
@@ -1252,6 +1434,14 @@ local void target_longest_match(s, cur_match)
 	*match            != *scan     ||
 	*++match          != scan[1])      continue;
       
+#if defined(DELTA_ISA_X86)
+    if(delta_isa >= DELTA_ISA_AVX2){
+      len = match_len_avx2(scan, s->window + cur_match);
+      if (len > s->lookahead) { len = s->lookahead; }
+    }
+    else
+#endif
+    {
     /* The check at best_len-1 can be removed because it will be made
      * again later. (This heuristic is not always a win.)
      * It is not necessary to compare scan[2] and match[2] since they
@@ -1277,6 +1467,7 @@ local void target_longest_match(s, cur_match)
     len = MAX_MATCH - (int)(strend - scan);
     if (len > s->lookahead) { len = s->lookahead; }
     scan = strend - MAX_MATCH;
+    }
  
     cur_distance = s->strstart - cur_match;
     GetBenefit(len, cur_distance);
@@ -1383,20 +1574,6 @@ else{                                            \
 }                                                              
  
 
-typedef struct pointer_history_s {
-  ulg len_hist[REFNUM][ZD_HIST_SIZE];
-  ulg ptr_hist[REFNUM][ZD_HIST_SIZE];
-  ulg sum_len[REFNUM];
-  ulg sum_ptr[REFNUM];
-
-  /* ulg ptr_val, avg_pos; */
-  ulg  avg_pos;
-  int front_ptr[REFNUM];
-  int back_ptr[REFNUM];
-  int ch_flag[REFNUM];
-} pointer_history;
-
-
 local void slide_ref_window(deflate_state *s, pointer_history *h, 
 			    int rw, int len, int match_start){
   ulg ptr_val;
@@ -1418,7 +1595,7 @@ local void slide_ref_window(deflate_state *s, pointer_history *h,
     h->ch_flag[rw] = 0;
     h->avg_pos = h->sum_ptr[rw] / h->sum_len[rw];
     
-    if((h->avg_pos < 22000) && (h->sum_len[rw] > 2000) && 
+    if((h->avg_pos < ZD_SLIDE_POS(s)) && (h->sum_len[rw] > 2000) && 
        (s->rwptr[2*rw]>(int)s->w_size ||
 	s->rwptr[2*rw+1]>(int)s->w_size)) 
     { 
@@ -1441,13 +1618,8 @@ local block_state delta_deflate_fast(deflate_state *s, int flush){
   int refnum = strm->refnum;
   int rw; 
 
-  /* data structures containing statistics for the sliding reference window */
-  pointer_history ph;
-
-  for(rw=0; rw<refnum; ++rw){
-    ph.sum_len[rw]   = ph.sum_ptr[rw]  = 0;
-    ph.front_ptr[rw] = ph.back_ptr[rw] = ph.ch_flag[rw] = 0;
-  }
+  /* statistics for the sliding reference window, kept across calls */
+  pointer_history *ph = &s->ph;
   
   for (;;){
 
@@ -1460,7 +1632,7 @@ local block_state delta_deflate_fast(deflate_state *s, int flush){
     }
     /*
     s->match_length    = MIN_MATCH-1;
-    s->match_distance  = ZD_UNREACHABLE;
+    s->match_distance  = ZD_REACH(s);
     s->match_benefit   = 0;
     */
     if (s->lookahead >= MIN_MATCH && s->strategy!=ZD_HUFFMAN_ONLY) {
@@ -1484,7 +1656,7 @@ local block_state delta_deflate_fast(deflate_state *s, int flush){
       }
       /* search in the target data       */
       if (hash_head != NIL &&  s->match_length < s->max_lazy_match && 
-	  s->strstart - hash_head <= ZD_UNREACHABLE) {
+	  s->strstart - hash_head <= ZD_REACH(s)) {
 	/* To simplify the code, we prevent matches with the string
 	 * of window index 0 (in particular we have to avoid a match
 	 * of the string with itself at the start of the input file).
@@ -1512,7 +1684,7 @@ local block_state delta_deflate_fast(deflate_state *s, int flush){
  
 	/* slide reference data here */
 	if(strm->base_avail[rw] > 0) 
-	  slide_ref_window(s, &ph, rw, s->match_length, s->match_start);
+	  slide_ref_window(s, ph, rw, s->match_length, s->match_start);
       }
       else{
 	/* output target match */
@@ -1532,13 +1704,13 @@ local block_state delta_deflate_fast(deflate_state *s, int flush){
 	  INSERT_STRING(s, s->strstart, hash_head);
 	} while (--s->match_length != 0);
 	s->strstart++;   
-	s->match_distance = ZD_UNREACHABLE;
+	s->match_distance = ZD_REACH(s);
 	s->match_benefit  = 0;
       }
       else{
 	s->strstart+=s->match_length;
 	s->match_length   = MIN_MATCH-1;
-	s->match_distance = ZD_UNREACHABLE;
+	s->match_distance = ZD_REACH(s);
 	s->match_benefit  = 0;
 	s->ins_h = s->window[s->strstart];
 	UPDATE_HASH(s, s->ins_h, s->window[s->strstart+1]);
@@ -1571,13 +1743,8 @@ local block_state delta_deflate_slow(deflate_state *s, int flush){
   zd_streamp strm = s->strm;
   int refnum = strm->refnum;
   int rw; 
-  /* data structures containing statistics for the sliding reference window */
-  pointer_history ph;
-
-  for(rw=0; rw<refnum; ++rw){
-    ph.sum_len[rw]   = ph.sum_ptr[rw]  = 0;
-    ph.front_ptr[rw] = ph.back_ptr[rw] = ph.ch_flag[rw] = 0;
-  }
+  /* statistics for the sliding reference window, kept across calls */
+  pointer_history *ph = &s->ph;
 
   for (;;){
 
@@ -1596,7 +1763,7 @@ local block_state delta_deflate_slow(deflate_state *s, int flush){
     s->prev_distance  = s->match_distance;
     s->prev_benefit   = s->match_benefit;
     s->match_length   = MIN_MATCH - 1;
-    s->match_distance = ZD_UNREACHABLE;
+    s->match_distance = ZD_REACH(s);
     s->match_benefit  = 0;
     if (s->lookahead >= MIN_MATCH && s->strategy!=ZD_HUFFMAN_ONLY) {
       INSERT_STRING(s, s->strstart, hash_head);
@@ -1619,7 +1786,7 @@ local block_state delta_deflate_slow(deflate_state *s, int flush){
       }
       /* search in the target data       */
       if (hash_head != NIL &&  s->match_length < s->max_lazy_match && 
-	  s->strstart - hash_head <= ZD_UNREACHABLE) {
+	  s->strstart - hash_head <= ZD_REACH(s)) {
 	/* To simplify the code, we prevent matches with the string
 	 * of window index 0 (in particular we have to avoid a match
 	 * of the string with itself at the start of the input file).
@@ -1653,7 +1820,7 @@ local block_state delta_deflate_slow(deflate_state *s, int flush){
 
 	/* slide reference data here */
 	if(strm->base_avail[rw] > 0) 
-	  slide_ref_window(s, &ph, rw, s->prev_length, s->prev_match);
+	  slide_ref_window(s, ph, rw, s->prev_length, s->prev_match);
       }
       else{
 	/* output target match */
@@ -1673,7 +1840,7 @@ local block_state delta_deflate_slow(deflate_state *s, int flush){
       } while (--s->prev_length != 0);
       s->match_available = 0;
       s->match_length   = MIN_MATCH-1;
-      s->match_distance = ZD_UNREACHABLE;
+      s->match_distance = ZD_REACH(s);
       s->match_benefit  = 0;
       s->strstart++; 
       if (bflush) FLUSH_BLOCK(s, 0);
@@ -34,8 +34,17 @@
 #define LITERALS  256
 /* number of literal bytes 0..255 */
 
-#define DIST_CODES 30
-/* number of distance codes, not countint the special END_OF_BLOCK code */
+#ifdef ZD_LARGE_WINDOW
+#  define DIST_CODES 48
+#else
+#  define DIST_CODES 30
+#endif
+/* number of distance codes, not countint the special END_OF_BLOCK code
+ * zdelta: the large window build adds two codes per doubling up to 16M
+ */
+
+#define DIST_CODES_32K 30
+/* zdelta: distance codes covered by zd_dist_code (distances below 32K) */
 
 #define LENGTH_CODES 37
 /* number of length codes in one length code Huffman tree */
@@ -55,6 +64,21 @@
 #define D_CODES   (LITERALS+1+DIST_CODES)
 /* number of Literal or Distance codes, including the END_OF_BLOCK code */
 
+#ifdef ZD_LARGE_WINDOW
+#  define DCODES_BITS 6
+#else
+#  define DCODES_BITS 5
+#endif
+/* zdelta: bits of the number of distance codes in a dynamic block header */
+
+#if defined(GEN_TREES_H) || !defined(STDC) || defined(ZD_LARGE_WINDOW)
+#  define BUILD_STATIC_TREES
+#endif
+/* zdelta: the static trees are built at run time instead of read from
+ * trees.h; always the case for the large window build, whose static
+ * literal/distance tree has more codes
+ */
+
 #define BL_CODES  19
 /* number of codes used to transfer the bit lengths */
 
@@ -106,14 +130,57 @@ typedef struct tree_desc_s {
   ulg     static_len;          /* compr. size of data if stat_desc used */
 } FAR tree_desc;
 
+#ifdef ZD_LARGE_WINDOW
+typedef uInt Pos;
+typedef uInt Dist;
+#else
 typedef ush Pos;
+typedef ush Dist;
+#endif
 typedef Pos FAR Posf;
+typedef Dist FAR Distf;
 typedef unsigned IPos;
 
 /* A Pos is an index in the character window. We use short instead of int to
  * save space in the various tables. IPos is used only for parameter passing.
+ * zdelta: a Dist is a match distance as kept in d_buf. Both are int in the
+ * large window build, where the window no longer fits 16 bits
+ */
+
+#ifdef ZD_LARGE_WINDOW
+#  define ZD_REACH(s) ((int)(s)->w_size)
+#else
+#  define ZD_REACH(s) ZD_UNREACHABLE
+#endif
+/* zdelta: matches at this distance or more from their pointer are not used;
+ * the large window build scales it with the window
+ */
+
+#ifdef ZD_LARGE_WINDOW
+#  define ZD_MAX_HASH_BITS 22
+#endif
+/* zdelta: the large window build hashes into as many heads as the window
+ * has bytes, up to 4M; three bytes give 24 bits of hash
  */
 
+/* zdelta: statistics of the recent reference matches, used to decide
+ * when the reference window slides
+ */
+#define ZD_HIST_SIZE      1000
+
+typedef struct pointer_history_s {
+  ulg len_hist[REFNUM][ZD_HIST_SIZE];
+  ulg ptr_hist[REFNUM][ZD_HIST_SIZE];
+  ulg sum_len[REFNUM];
+  ulg sum_ptr[REFNUM];
+
+  /* ulg ptr_val, avg_pos; */
+  ulg  avg_pos;
+  int front_ptr[REFNUM];
+  int back_ptr[REFNUM];
+  int ch_flag[REFNUM];
+} pointer_history;
+
 typedef struct zd_internal_state {
   zd_streamp strm;      /* pointer back to this zlib stream */
   int   status;        /* as the name implies */
@@ -132,6 +199,9 @@ typedef struct zd_internal_state {
   uInt  w_bits;         /* log2(w_size)  (8..16) */
   uInt  w_mask;         /* w_size - 1 */
   uInt  rw_mask;        /* zdelta: 2*w_size - 1 */
+#ifdef ZD_LARGE_WINDOW
+  int   w_auto;         /* zdelta: w_bits was picked by zd_deflateInit */
+#endif
   
 
   Bytef *window;
@@ -288,7 +358,7 @@ typedef struct zd_internal_state {
 
   uInt last_lit;      /* running index in l_buf */
 
-  ushf *d_buf;
+  Distf *d_buf;
   /* Buffer for distances. To simplify the code, d_buf and l_buf have
    * the same number of elements. To use different lengths, an extra flag
    * array would be necessary.
@@ -335,6 +405,18 @@ typedef struct zd_internal_state {
 				      of the most recent flush */
   uch stored_allowed[REFNUM];
 
+  /* bytes of the reference held and hashed in ref_window when it all fit
+   * and the window never slid; 0 otherwise. Lets zd_deflateResetKeepRef
+   * reuse the reference dictionary for the next target
+   */
+  ulg ref_kept[REFNUM];
+
+  /* reference match statistics; in the state rather than on the stack of
+   * the deflate functions, so that the window slides the same way however
+   * the target is split across zd_deflate calls
+   */
+  pointer_history ph;
+
 } FAR deflate_state;
 
 /* Output a byte on the stream.
@@ -364,11 +446,20 @@ void zd_tr_align        OF((deflate_state *s));
 void zd_tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
                           int eof));
 
-#define d_code(dist) \
+#ifdef ZD_LARGE_WINDOW
+#  define d_code(dist) \
+   ((dist) < 256 ? zd_dist_code[dist] : \
+    (dist) < 32768 ? zd_dist_code[256+((dist)>>7)] : \
+    (uch)(2*(31-__builtin_clz(dist)) + (((dist)>>(30-__builtin_clz(dist)))&1)))
+#else
+#  define d_code(dist) \
    ((dist) < 256 ? zd_dist_code[dist] : zd_dist_code[256+((dist)>>7)])
+#endif
 /* Mapping from a distance to a distance code. dist is the distance - 1 and
  * must not have side effects. zd_dist_code[256] and zd_dist_code[257] are
  * never used.
+ * zdelta: from 32K on, the code is twice the bit length minus 2 plus the
+ * bit below the top one, as the table gives for shorter distances
  */
 
 #define z_code(z) (z & 0x1f)
@@ -386,7 +477,7 @@ void zd_tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
 #define ZCODE(sgn,ptr) (sgn|ptr)
 
 /* Inline versions of _tr_tally for speed: */
-#if defined(GEN_TREES_H) || !defined(STDC)
+#ifdef BUILD_STATIC_TREES
   extern uch zd_length_code[];
   extern uch zd_dist_code[];
 #else
@@ -408,7 +499,7 @@ void zd_tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
 /* zdelta: modified to handle the extra zdelta code */
 # define _tr_tally_dist_ref(s, distance, length, zd, flush) \
   { ush len = (length); \
-    ush dist = (distance); \
+    Dist dist = (distance); \
     s->d_buf[s->last_lit]   = dist; \
     s->z_buf[s->last_lit]   = zd; \
     s->l_buf[s->last_lit++] = len; \
@@ -420,7 +511,7 @@ void zd_tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
 
 # define _tr_tally_dist_tar(s, distance, length, flush) \
   { ush len = (length); \
-    ush dist = (distance); \
+    Dist dist = (distance); \
     s->d_buf[s->last_lit]   = dist; \
     s->z_buf[s->last_lit]   = TARGET; \
     s->l_buf[s->last_lit++] = len; \
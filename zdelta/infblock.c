@@ -24,7 +24,11 @@
 #include "infutil.h"
 
 #define LBL   7   /* lengths codes number bit length    */
-#define DBL   5   /* distances codes number bit length  */
+#ifdef ZD_LARGE_WINDOW
+#  define DBL 6   /* distances codes number bit length  */
+#else
+#  define DBL 5   /* distances codes number bit length  */
+#endif
 #if REFNUM>1
 # define ZBL   3   /* zdelta codes number bit length    */
 #else
@@ -175,7 +175,7 @@ int inflate_codes(s, z, r)
     }
     if (e & 16)               /* distance */
     {
-      c->sub.copy.get = e & 15;
+      c->sub.copy.get = DEXTRA(e);
       c->dist = t->base;
       c->mode = DISTEXT;
       break;
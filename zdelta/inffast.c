@@ -100,8 +100,8 @@ zd_streamp z;
       DUMPBITS(t->bits)
       if (e & 16)
       {
-	e &= 15;
-	GRABBITS(e) /* get extra bits for distance (up to 13) */
+	e = DEXTRA(e);
+	GRABBITS(e) /* get extra bits for distance (up to 13, or 22) */
 	d = t->base + ((uInt)b & inflate_mask[e]);
 	Assert(e <= k, "dumping too many bits (dist extra)");
 	DUMPBITS(e)
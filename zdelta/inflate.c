@@ -59,14 +59,54 @@ struct zd_internal_state {
   /* mode independent information */
   int  nowrap;          /* flag for no wrapper */
   uInt wbits;           /* log2(window size)  (8..15, defaults to 15) */
+#ifdef ZD_LARGE_WINDOW
+  int  w_auto;          /* zdelta: wbits was taken from the header */
+#endif
   inflate_blocks_statef 
   *blocks;              /* current inflate_blocks state */
 
 };
 
 
+#ifdef ZD_LARGE_WINDOW
+/* zdelta: added
+ * windowBits given by the header at next_in, or 0 if there is none
+ */
+local uInt header_wbits(z)
+     zd_streamp z;
+{
+#ifdef NO_ERROR_CHECK
+  return 0;
+#else
+  uInt w;
+
+  if (z->next_in == ZD_NULL || z->avail_in < 2 ||
+      (z->next_in[0] & 0xf) != ZD_DEFLATED)
+    return 0;
+  w = (z->next_in[0] >> 4) + WBITS_BASE;
+  return w <= MAX_WBITS ? w : 0;
+#endif
+}
+#endif
+
+local int inflate_reset OF((zd_streamp z));
+
 int ZEXPORT zd_inflateReset(z)
      zd_streamp z;
+{
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: the window zd_inflateInit sized for an earlier delta is too
+   *         small for this one; the caller starts over with a new stream
+   */
+  if (z != ZD_NULL && z->state != ZD_NULL && z->state->w_auto &&
+      header_wbits(z) > z->state->wbits)
+    return ZD_BUF_ERROR;
+#endif
+  return inflate_reset(z);
+}
+
+local int inflate_reset(z)
+     zd_streamp z;
 {
   if (z == ZD_NULL || z->state == ZD_NULL ||
       z->refnum<0 || z->refnum>REFNUM)
@@ -133,12 +173,15 @@ int ZEXPORT zd_inflateInit2_(z, w, version, stream_size)
   }
 
   /* set window size */
-  if (w < 8 || w > 15)
+  if (w < WBITS_BASE || w > MAX_WBITS)
   {
     zd_inflateEnd(z);
     return ZD_STREAM_ERROR;
   }
   z->state->wbits = (uInt)w;
+#ifdef ZD_LARGE_WINDOW
+  z->state->w_auto = 0;
+#endif
 
   /* create inflate_blocks state */
   if ((z->state->blocks =
@@ -151,7 +194,7 @@ int ZEXPORT zd_inflateInit2_(z, w, version, stream_size)
   Tracev((stderr, "inflate: allocated\n"));
   
   /* reset state */
-  zd_inflateReset(z);
+  inflate_reset(z);
 
   return ZD_OK;
 }
@@ -162,7 +205,17 @@ int ZEXPORT zd_inflateInit_(z, version, stream_size)
      const char *version;
      int stream_size;
 {
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: size the window from the header of the delta when it is
+   *         already at next_in, instead of always taking 16M
+   */
+  int w = z == ZD_NULL ? 0 : (int)header_wbits(z);
+  int err = zd_inflateInit2_(z, w ? w : DEF_WBITS, version, stream_size);
+  if (err == ZD_OK && w) z->state->w_auto = 1;
+  return err;
+#else
   return zd_inflateInit2_(z, DEF_WBITS, version, stream_size);
+#endif
 }
 
 
@@ -196,7 +249,7 @@ int ZEXPORT zd_inflate(z, f)
       break;
     }
 
-    if ((z->state->sub.method >> 4) + 8 > z->state->wbits)
+    if ((z->state->sub.method >> 4) + WBITS_BASE > z->state->wbits)
     {
       z->state->mode = BAD;
       z->msg = (char*)"invalid window size";
@@ -319,7 +372,7 @@ zd_streamp z;
   if (m != 4)
     return ZD_DATA_ERROR;
   r = z->total_in;  w = z->total_out;
-  zd_inflateReset(z);
+  inflate_reset(z);
   z->total_in = r;  z->total_out = w;
   z->state->mode = BLOCKS;
   return ZD_OK;
@@ -23,6 +23,13 @@
 #  define BUILDFIXED   /* non ANSI compilers may not accept inffixed.h */
 #endif
 
+/* zdelta: inffixed.h holds the standard fixed tables; the large window
+ * build has its own fixed distance tree and builds its tables at run time
+ */
+#if defined(BUILDFIXED) || defined(ZD_LARGE_WINDOW)
+#  define BUILD_FIXED_TABLES
+#endif
+
 const char inflate_copyright[] =
    " inflate 1.1.3 Copyright 1995-1998 Mark Adler ";
 /*
@@ -53,12 +60,24 @@ local int huft_build OF((
 local const uInt cpdist[D_CODES] = {/* Copy offsets for distance codes 0..29 */
         0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192,
         256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144,
-        8192, 12288, 16384, 24576};
+        8192, 12288, 16384, 24576
+#ifdef ZD_LARGE_WINDOW
+        /* zdelta: codes 30..47 */
+        , 32768, 49152, 65536, 98304, 131072, 196608, 262144, 393216,
+        524288, 786432, 1048576, 1572864, 2097152, 3145728,
+        4194304, 6291456, 8388608, 12582912
+#endif
+};
 
 local const uInt cpdext[D_CODES] = { /* Extra bits for distance codes */
         0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
         7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
-        12, 12, 13, 13};
+        12, 12, 13, 13
+#ifdef ZD_LARGE_WINDOW
+        , 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+        20, 20, 21, 21, 22, 22
+#endif
+};
 
 
 local const uInt cplens[L_CODES] = { /* Copy lengths for len codes */
@@ -311,7 +330,12 @@ uIntf *v;               /* working area: values in order of bit length */
       }
       else
       {
+#ifdef ZD_LARGE_WINDOW
+        r.exop = (Byte)(e[*p - s] > 15 ?     /* see DEXTRA */
+                        e[*p - s] - 8 + 16 + 64 + 128 : e[*p - s] + 16 + 64);
+#else
         r.exop = (Byte)(e[*p - s] + 16 + 64);/* non-simple--look up in lists */
+#endif
         r.base = d[*p++ - s];
       }
 
@@ -369,7 +393,7 @@ zd_streamp z;            /* for messages */
 }
 
 /* build fixed tables only once--keep them here */
-#ifdef BUILDFIXED
+#ifdef BUILD_FIXED_TABLES
 
 local int fixed_built = 0;
 
@@ -403,7 +427,7 @@ inflate_huft * FAR *td;  /* distance tree result                 */
 inflate_huft * FAR *tzd; /* zdelta code tree result              */
 zd_streamp z;             /* for memory allocation                */
 {
-#ifdef BUILDFIXED
+#ifdef BUILD_FIXED_TABLES
 /* build fixed tables if not already */
 if (!fixed_built)
 {
@@ -452,18 +476,31 @@ if (!fixed_built)
 		 fixed_mem, &f, v);
 
   /* distance table */
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: same lengths as static_dtree in trees.c */
+  for (k = 0; k <= 254; k++)
+    c[k] = 9;
+  for (; k <= 282; k++)
+    c[k] = 6;
+  for (; k <= 292; k++)
+    c[k] = 8;
+  for (; k <= 305; k++)
+    c[k] = 9;
+#else
   for (k = 0; k <= 254; k++)
     c[k] = 9;
   for (; k <= 286; k++)
     c[k] = 6;
   for (; k <= 287; k++)
     c[k] = 9;
+#endif
 
   fixed_bd = 9;
   huft_build(c, D_CODES, 257, cpdist, cpdext, &fixed_td, &fixed_bd,
 	     fixed_mem, &f, v);
   
   /* zdelta table */
+#if Z_CODES > 2
   for (k = 0; k <= 1; k++)
     c[k] = 2;
   for (; k <= 3; k++)
@@ -472,6 +509,11 @@ if (!fixed_built)
     c[k] = 4;
 
   fixed_bzd = 4;
+#else
+  c[0] = c[1] = 1;
+
+  fixed_bzd = 1;
+#endif
   huft_build(c, Z_CODES, Z_CODES, ZD_NULL, ZD_NULL, &fixed_tzd, &fixed_bzd,
 	     fixed_mem, &f, v);
   
@@ -584,6 +626,21 @@ zd_streamp z;            /* for messages */
 # endif
   }
 #else
+# ifdef BUILD_FIXED_TABLES
+  /* zdelta: the one reference tree is the fixed one, built on first use */
+  if (!fixed_built)
+  {
+    uInt fbl, fbd;
+    inflate_huft *ftl, *ftd;
+
+    r = inflate_trees_fixed(&fbl, &fbd, bzd, &ftl, &ftd, tzd, z);
+    if (r != ZD_OK)
+    {
+      ZFREE(z, v);
+      return r;
+    }
+  }
+# endif
   *bzd = fixed_bzd;
   *tzd = fixed_tzd;
 #endif /* REFNUM > 1 */
@@ -41,7 +41,11 @@ struct inflate_huft_s {
 #define REFMATCH   (1<<14)
 #define NREFMATCH  ((1<<15) | REFMATCH)
 
-#define D_CODES  288     /* number of literal/distance codes */
+#ifdef ZD_LARGE_WINDOW
+#  define D_CODES 306    /* number of literal/distance codes */
+#else
+#  define D_CODES 288    /* number of literal/distance codes */
+#endif
 #define L_CODES  111     /* number of length codes           */
 #if REFNUM>1 || BUILDFIXED || GEN_TREES_H
 # define Z_CODES    8     /* number of zdelta codes           */
@@ -57,7 +61,21 @@ struct inflate_huft_s {
    and 154 for distances, the latter actually the result of an
    exhaustive search).  The actual maximum is not known, but the
    value below is more than safe. */
-#define MANY 1440
+#ifdef ZD_LARGE_WINDOW
+#  define MANY 1600     /* zdelta: 18 more distance codes */
+#else
+#  define MANY 1440
+#endif
+
+/* zdelta: extra bits of a distance code. Exop keeps them in its low four
+ * bits; the large window build has codes with up to 22, which set 128 and
+ * keep the extra bits less 8
+ */
+#ifdef ZD_LARGE_WINDOW
+#  define DEXTRA(e) (((e) & 15) + (((e) & 128) >> 4))
+#else
+#  define DEXTRA(e) ((e) & 15)
+#endif
 
 extern int inflate_trees_bits OF((
     uIntf *,                    /* 19 code lengths                       */
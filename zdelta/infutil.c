@@ -24,10 +24,13 @@
 /* struct inflate_codes_state {int dummy;}; */ /* for buggy compilers */
 
 /* And'ing with mask[n] masks the lower n bits */
-uInt inflate_mask[17] = {
+uInt inflate_mask[INFLATE_MASK_LEN] = {
     0x0000,
     0x0001, 0x0003, 0x0007, 0x000f, 0x001f, 0x003f, 0x007f, 0x00ff,
     0x01ff, 0x03ff, 0x07ff, 0x0fff, 0x1fff, 0x3fff, 0x7fff, 0xffff
+#ifdef ZD_LARGE_WINDOW
+    , 0x1ffff, 0x3ffff, 0x7ffff, 0xfffff, 0x1fffff, 0x3fffff
+#endif
 };
 
 
@@ -115,7 +115,12 @@ struct inflate_blocks_state {
 
 
 /* masks for lower bits (size given to avoid silly warnings with Visual C++) */
-extern uInt inflate_mask[17];
+#ifdef ZD_LARGE_WINDOW
+#  define INFLATE_MASK_LEN 23   /* zdelta: up to 22 extra distance bits */
+#else
+#  define INFLATE_MASK_LEN 17
+#endif
+extern uInt inflate_mask[INFLATE_MASK_LEN];
 
 /* copy as much as possible from the sliding window to the output area */
 extern int inflate_flush OF((
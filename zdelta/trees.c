@@ -89,7 +89,11 @@ local const int extra_lbits[L_CODES]
    };
 
 local const int extra_dbits[DIST_CODES] /* extra bits for each distance code */
-   = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+   = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13
+#ifdef ZD_LARGE_WINDOW
+      ,14,14,15,15,16,16,17,17,18,18,19,19,20,20,21,21,22,22
+#endif
+};
 
 local const int extra_blbits[BL_CODES]/* extra bits for each bit length code */
    = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,3,7};
@@ -113,7 +117,7 @@ local const uch bl_order[BL_CODES]
 
 
 
-#if defined(GEN_TREES_H) || !defined(STDC)
+#ifdef BUILD_STATIC_TREES
 /* non ANSI compilers may not accept trees.h */
 
 local ct_data static_ltree[L_CODES];
@@ -148,7 +152,7 @@ local int base_dist[D_CODES];
 
 #else
 #  include "trees.h"
-#endif /* GEN_TREES_H */
+#endif /* BUILD_STATIC_TREES */
 
 struct static_tree_desc_s {
     const ct_data *static_tree;  /* static tree or NULL */
@@ -281,7 +285,7 @@ local void send_bits(s, value, length)
  */
 local void tr_static_init()
 {
-#if defined(GEN_TREES_H) || !defined(STDC)
+#ifdef BUILD_STATIC_TREES
   static int static_init_done = 0;
   int n;        /* iterates over tree elements */
   int bits;     /* bit counter */
@@ -338,13 +342,17 @@ local void tr_static_init()
   }
   Assert (dist == 256, "tr_static_init: dist != 256");
   dist >>= 7; /* from now on, all distances are divided by 128 */
-  for ( ; code < DIST_CODES; code++) {
+  for ( ; code < DIST_CODES_32K; code++) {
     base_dist[code] = dist << 7;
     for (n = 0; n < (1<<(extra_dbits[code]-7)); n++) {
       zd_dist_code[256 + dist++] = (uch)code;
     }
   }
   Assert (dist == 256, "tr_static_init: 256+dist != 512");
+  /* zdelta: distances from 32K on are mapped by d_code without a table */
+  for ( ; code < DIST_CODES; code++) {
+    base_dist[code] = (2 | (code & 1)) << extra_dbits[code];
+  }
 
   /* Construct the codes of the static length tree */
   for (bits = 0; bits <= MAX_BITS; bits++) bl_count[bits] = 0;
@@ -378,18 +386,31 @@ local void tr_static_init()
   /* Construct the codes of the  static literal/distance tree */
   for (bits = 0; bits <= MAX_BITS; bits++) bl_count[bits] = 0;
   n = 0;
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: distance codes from 8K on take 8 and 9 bits to make room */
+  while (n <= 254) static_dtree[n++].Len = 9, bl_count[9]++;
+  while (n <= 282) static_dtree[n++].Len = 6, bl_count[6]++;
+  while (n <= 292) static_dtree[n++].Len = 8, bl_count[8]++;
+  while (n <= 305) static_dtree[n++].Len = 9, bl_count[9]++;
+#else
   while (n <= 254) static_dtree[n++].Len = 9, bl_count[9]++;
   while (n <= 286) static_dtree[n++].Len = 6, bl_count[6]++;
   while (n <= 287) static_dtree[n++].Len = 9, bl_count[9]++;
+#endif
 
   gen_codes((ct_data *)static_dtree, D_CODES, bl_count);
 
   /* Construct the codes of the  static zdelta tree */
   for (bits = 0; bits <= MAX_BITS; bits++) bl_count[bits] = 0;
   n = 0;
+#if Z_CODES > 2
   while (n <= 1) static_ztree[n++].Len = 2, bl_count[2]++;
   while (n <= 3) static_ztree[n++].Len = 3, bl_count[3]++;
   while (n <= 7) static_ztree[n++].Len = 4, bl_count[4]++;
+#else
+  /* zdelta: one reference, as in trees.h */
+  while (n <= 1) static_ztree[n++].Len = 1, bl_count[1]++;
+#endif
 
   gen_codes((ct_data *)static_ztree, Z_CODES-1, bl_count);
 
@@ -398,7 +419,7 @@ local void tr_static_init()
 #  ifdef GEN_TREES_H
   zd_gen_trees_header();
 #  endif
-#endif /* defined(GEN_TREES_H) || !defined(STDC) */
+#endif /* BUILD_STATIC_TREES */
 }
 
 /* ===========================================================================
@@ -970,7 +991,7 @@ local void send_all_trees(s, lcodes, dcodes, zcodes, blcodes)
   send_bits(s, lcodes-1,   7); /* not +255 as stated in appnote.txt */
   Tracev((stderr, "\n # len codes   :%u", lcodes-1));
 
-  send_bits(s, dcodes-257, 5);
+  send_bits(s, dcodes-257, DCODES_BITS);
   Tracev((stderr, "\n # dist codes  :%u", dcodes-257));
 
 #if REFNUM>1
@@ -1132,7 +1153,13 @@ void zd_tr_flush_block(s, buf, stored_len, eof)
     stored_allowed &= s->stored_allowed[i];
   } 
 
+#ifdef ZD_LARGE_WINDOW
+  /* zdelta: a block may cover more than the 16 bit stored length here */
+  if (stored_allowed && stored_len+4 <= opt_lenb && buf != (char*)0 &&
+      stored_len <= 0xffff){ 
+#else
   if (stored_allowed && stored_len+4 <= opt_lenb && buf != (char*)0){ 
+#endif
     /* 4: two words for the lengths */
     /* zdelta: s->stored_allowed is false if the reference window is
      * slided; this invalidates the stored reference window pointers
@@ -1297,6 +1324,13 @@ local void compress_block(s, ltree, dtree, zdtree)
       extra = extra_dbits[code];
       if (extra != 0) {
 	dist -= base_dist[code];
+#ifdef ZD_LARGE_WINDOW
+	if (extra > 16) {        /* send_bits takes at most 16 bits at once */
+	  send_bits(s, dist & 0xffff, 16);
+	  dist >>= 16;
+	  extra -= 16;
+	}
+#endif
 	send_bits(s, dist, extra);          /* send the extra distance bits */
       }
       code = l_code(lc);        /* Here, lc is the match length - MIN_MATCH */
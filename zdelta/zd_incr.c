@@ -0,0 +1,201 @@
+/* file: zd_incr.c
+ * incremental zdelta interface with plain C callbacks
+ * see zd_incr.h for documentation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zutil.h"
+#include "zd_incr.h"
+
+/* reads into buf until size bytes are stored or the reader reports the
+ * end of the data; *len is the number of bytes stored
+ */
+local int fill_buf(zd_reader_func reader, voidpf opaque,
+		   Bytef *buf, uLong size, uLong *len, int *eof)
+{
+  int rval;
+  uLong got;
+
+  *len = 0;
+  while(*len < size && !*eof){
+    rval = reader(opaque, buf + *len, size - *len, &got);
+    if(rval != ZD_OK) return rval;
+    if(got == 0) *eof = 1;
+    *len += got;
+  }
+  return ZD_OK;
+}
+
+/* passes the bytes deflate/inflate stored in buf to the writer */
+local int call_writer(zd_writer_func writer, voidpf opaque,
+		      const Bytef *buf, const Bytef *next_out)
+{
+  if(next_out == buf) return ZD_OK;
+  return writer(opaque, buf, (uLong)(next_out - buf));
+}
+
+int ZEXPORT zd_compress_cb(const Bytef *ref, uLong rsize,
+			   zd_reader_func tar_reader, voidpf tar_opaque,
+			   zd_writer_func delta_writer, voidpf delta_opaque,
+			   uLong bufsize)
+{
+  int rval, wval;
+  int eof = 0;
+  int flush;
+  uLong len;
+  Bytef *in, *out;
+  zd_stream strm;
+
+  if(bufsize == 0) bufsize = ZD_INCR_BUFSIZE;
+  in  = (Bytef*) malloc(bufsize);
+  out = (Bytef*) malloc(bufsize);
+  if(in == ZD_NULL || out == ZD_NULL){
+    free(in);
+    free(out);
+    return ZD_MEM_ERROR;
+  }
+
+  /* zd_deflateInit reads the first window of the target, so the input
+   * buffer is filled before the stream is set up
+   */
+  rval = fill_buf(tar_reader, tar_opaque, in, bufsize, &len, &eof);
+  if(rval != ZD_OK) goto release;
+
+  /* init io buffers */
+  strm.base[0]       = (Bytef*) ref;
+  strm.base_avail[0] = rsize;
+  strm.base_out[0]   = 0;
+  strm.refnum        = 1;
+
+  strm.next_in  = in;
+  strm.total_in = 0;
+  strm.avail_in = (uInt)len;
+
+  strm.zalloc = (alloc_func)0;
+  strm.zfree  = (free_func)0;
+  strm.opaque = (voidpf)0;
+  rval = zd_deflateInit(&strm, ZD_DEFAULT_COMPRESSION);
+  if(rval != ZD_OK) goto release;
+
+  for(;;){
+    flush = eof ? ZD_FINISH : Z_NO_FLUSH;
+
+    /* run deflate until it stops filling the output buffer,
+     * at that point all the input has been consumed
+     */
+    do{
+      strm.next_out  = out;
+      strm.avail_out = (uInt)bufsize;
+      rval = zd_deflate(&strm, flush);
+      if(rval != ZD_OK && rval != ZD_STREAM_END && rval != ZD_BUF_ERROR)
+	goto end;
+      wval = call_writer(delta_writer, delta_opaque, out, strm.next_out);
+      if(wval != ZD_OK){
+	rval = wval;
+	goto end;
+      }
+    } while(strm.avail_out == 0);
+
+    if(rval == ZD_STREAM_END){
+      rval = ZD_OK;
+      break;
+    }
+    if(eof){
+      rval = ZD_BUF_ERROR; /* ZD_FINISH with room left must end the stream */
+      break;
+    }
+
+    rval = fill_buf(tar_reader, tar_opaque, in, bufsize, &len, &eof);
+    if(rval != ZD_OK) break;
+    strm.next_in  = in;
+    strm.avail_in = (uInt)len;
+  }
+
+end:
+  zd_deflateEnd(&strm);
+release:
+  free(in);
+  free(out);
+  return rval;
+}
+
+int ZEXPORT zd_uncompress_cb(const Bytef *ref, uLong rsize,
+			     zd_reader_func delta_reader, voidpf delta_opaque,
+			     zd_writer_func tar_writer, voidpf tar_opaque,
+			     uLong bufsize)
+{
+  int rval, wval;
+  int eof = 0;
+  uLong len, keep;
+  Bytef *in, *out;
+  zd_stream strm;
+
+  if(bufsize == 0) bufsize = ZD_INCR_BUFSIZE;
+  in  = (Bytef*) malloc(bufsize);
+  out = (Bytef*) malloc(bufsize);
+  if(in == ZD_NULL || out == ZD_NULL){
+    free(in);
+    free(out);
+    return ZD_MEM_ERROR;
+  }
+
+  /* init io buffers */
+  strm.base[0]       = (Bytef*) ref;
+  strm.base_avail[0] = rsize;
+  strm.refnum        = 1;
+
+  strm.next_in  = in;
+  strm.total_in = 0;
+  strm.avail_in = 0;
+
+  strm.zalloc = (alloc_func)0;
+  strm.zfree  = (free_func)0;
+  strm.opaque = (voidpf)0;
+  rval = zd_inflateInit(&strm);
+  if(rval != ZD_OK) goto release;
+
+  do{
+    /* keep the delta bytes inflate has not consumed yet */
+    keep = strm.avail_in;
+    if(keep != 0 && strm.next_in != in) memmove(in, strm.next_in, keep);
+    rval = fill_buf(delta_reader, delta_opaque, in + keep, bufsize - keep,
+		    &len, &eof);
+    if(rval != ZD_OK) break;
+    if(keep + len == 0){
+      rval = ZD_DATA_ERROR; /* the delta ended before the stream did */
+      break;
+    }
+    strm.next_in  = in;
+    strm.avail_in = (uInt)(keep + len);
+
+    do{
+      strm.next_out  = out;
+      strm.avail_out = (uInt)bufsize;
+      rval = zd_inflate(&strm, ZD_SYNC_FLUSH);
+      if(rval != ZD_OK && rval != ZD_STREAM_END && rval != ZD_BUF_ERROR)
+	goto end;
+      wval = call_writer(tar_writer, tar_opaque, out, strm.next_out);
+      if(wval != ZD_OK){
+	rval = wval;
+	goto end;
+      }
+    } while(strm.avail_out == 0 && rval != ZD_STREAM_END);
+
+    if(rval != ZD_STREAM_END && eof && strm.avail_in == keep + len){
+      rval = ZD_DATA_ERROR; /* no progress on the last of the delta */
+      break;
+    }
+  } while(rval != ZD_STREAM_END);
+
+  if(rval == ZD_STREAM_END) rval = ZD_OK;
+
+end:
+  if(rval != ZD_OK && strm.msg != ZD_NULL) fprintf(stderr, "%s\n", strm.msg);
+  zd_inflateEnd(&strm);
+release:
+  free(in);
+  free(out);
+  return rval;
+}
@@ -0,0 +1,72 @@
+/* file: zd_incr.h
+ * incremental zdelta interface with plain C callbacks
+ *
+ * Same idea as zd_compress_incr/zd_uncompress_incr in blocks/, but
+ * without Clang blocks, and the target (or delta) is pulled through a
+ * reader as well. Compression and decompression then need only the
+ * reference in memory plus the stream state and two buffers of bufsize
+ * bytes, whatever the size of the target.
+ */
+
+#ifndef ZD_INCR_H
+#define ZD_INCR_H
+
+#include "zdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* default size of the input and output buffers */
+#define ZD_INCR_BUFSIZE (64*1024)
+
+/* fills buf with up to size bytes and sets *got to the number stored;
+ * *got == 0 marks the end of the data. A return value other than ZD_OK
+ * stops the operation, which then returns that value.
+ */
+typedef int (*zd_reader_func) OF((voidpf opaque, Bytef *buf, uLong size,
+				  uLong *got));
+
+/* takes the next size bytes of output; a return value other than ZD_OK
+ * stops the operation, which then returns that value.
+ */
+typedef int (*zd_writer_func) OF((voidpf opaque, const Bytef *piece,
+				  uLong size));
+
+/* computes the zdelta difference between the target given by tar_reader
+ * and the reference data, and passes it to delta_writer piece by piece
+ *
+ * INPUT:
+ * ref      pointer to reference data set
+ * rsize    size of reference data set
+ * bufsize  size of the input and output buffers; 0 for ZD_INCR_BUFSIZE
+ *
+ * zd_compress_cb returns ZD_OK on success, ZD_MEM_ERROR if there was not
+ * enough memory, or the error returned by a callback
+ */
+ZEXTERN int ZEXPORT zd_compress_cb OF((const Bytef *ref, uLong rsize,
+				       zd_reader_func tar_reader,
+				       voidpf tar_opaque,
+				       zd_writer_func delta_writer,
+				       voidpf delta_opaque,
+				       uLong bufsize));
+
+/* rebuilds the target from the reference data and the zdelta difference
+ * given by delta_reader, and passes it to tar_writer piece by piece
+ *
+ * zd_uncompress_cb returns ZD_OK on success, ZD_DATA_ERROR if the delta
+ * is corrupt or truncated, ZD_MEM_ERROR if there was not enough memory,
+ * or the error returned by a callback
+ */
+ZEXTERN int ZEXPORT zd_uncompress_cb OF((const Bytef *ref, uLong rsize,
+					 zd_reader_func delta_reader,
+					 voidpf delta_opaque,
+					 zd_writer_func tar_writer,
+					 voidpf tar_opaque,
+					 uLong bufsize));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -36,12 +36,15 @@
 #  define zd_inflateEnd	        zdel_inflateEnd
 #  define zd_deflateInit2_	zdel_deflateInit2_
 #  define zd_deflateReset	zdel_deflateReset
+#  define zd_deflateResetKeepRef	zdel_deflateResetKeepRef
 #  define zd_inflateInit2_	zdel_inflateInit2_
 #  define zd_inflateReset	zdel_inflateReset
 #  define zd_compress	        zdel_compress
 #  define zd_compress1	        zdel_compress2
 #  define zd_uncompress	        zdel_uncompress
 #  define zd_uncompress1	zdel_uncompress1
+#  define zd_compress_reuse	zdel_compress_reuse
+#  define zd_uncompress_reuse	zdel_uncompress_reuse
 #  define zd_adler32	        zdel_adler32
 
 #  define Byte		zdel_Byte
@@ -120,9 +123,19 @@
  * gzip.)
  */
 #ifndef MAX_WBITS
-#  define MAX_WBITS   15 /* 32K LZ77 window */
+#  ifdef ZD_LARGE_WINDOW
+#    define MAX_WBITS 24 /* zdelta: 16M window, see ZD_LARGE_WINDOW below */
+#  else
+#    define MAX_WBITS 15 /* 32K LZ77 window */
+#  endif
 #endif
 
+/* zdelta: compile with -DZD_LARGE_WINDOW for windows of up to 16M. The
+ * compressor then sizes the window to the larger of the reference and the
+ * target, and the distance code gains 18 codes for distances up to 16M.
+ * Deltas of this build are not compatible with those of the standard one.
+ */
+
 /* The memory requirements for deflate are (in bytes):
             (1 << (windowBits+2)) +  (1 << (memLevel+9))
  that is: 128K for windowBits=15  +  128K for memLevel = 8  (default values)
@@ -70,6 +70,66 @@ int ZEXPORT zd_compress(const Bytef *ref,  uLong rsize,
   return zd_deflateEnd(&strm);
 }
 
+/*
+ * same as zd_compress, with a stream kept by the caller
+ */
+int ZEXPORT zd_compress_reuse(zd_streamp strm, int keep_ref,
+			      const Bytef *ref, uLong rsize,
+			      const Bytef *tar, uLong tsize,
+			      Bytef *delta, uLongf *dsize)
+{
+  int rval;
+
+  /* init io buffers */
+  strm->base[0]  = (Bytef*) ref;
+  strm->base_avail[0] = rsize;
+  strm->base_out[0] = 0;
+  strm->refnum      = 1;
+
+  strm->next_in  = (Bytef*) tar;
+  strm->total_in = 0;
+  strm->avail_in = tsize;
+
+  strm->next_out  = delta; 
+  strm->total_out = 0;
+  strm->avail_out = *dsize; 
+
+  /* allocate the state on the first call, reset it afterwards */
+  if (strm->state == ZD_NULL)
+  {
+    strm->zalloc = (alloc_func)0;
+    strm->zfree = (free_func)0;
+    strm->opaque = (voidpf)0;
+    rval = zd_deflateInit(strm, ZD_DEFAULT_COMPRESSION);
+  }
+  else
+  {
+    rval = keep_ref ? zd_deflateResetKeepRef(strm) : zd_deflateReset(strm);
+#ifdef ZD_LARGE_WINDOW
+    /* the window is too small for these inputs; get a larger one */
+    if (rval == ZD_BUF_ERROR)
+    {
+      zd_deflateEnd(strm);
+      rval = zd_deflateInit(strm, ZD_DEFAULT_COMPRESSION);
+    }
+#endif
+  }
+  if (rval != ZD_OK)
+  {
+    fprintf(stderr, "%s error: %d\n", "deflateInit", rval);
+    return rval;
+  }
+
+  /* compress the data */
+  rval = zd_deflate(strm,ZD_FINISH);
+  if(rval != ZD_STREAM_END){
+    return rval == ZD_OK ? ZD_BUF_ERROR : rval;
+  }
+
+  *dsize = strm->total_out;
+  return ZD_OK;
+}
+
 /*
  * same as above, but with dynamic memory allocation
  */
@@ -327,6 +387,64 @@ int ZEXPORT zd_uncompress(const Bytef *ref, uLong rsize,
   return zd_inflateEnd(&strm);
 }
 
+/*
+ * same as zd_uncompress, with a stream kept by the caller
+ */
+int ZEXPORT zd_uncompress_reuse(zd_streamp strm,
+				const Bytef *ref, uLong rsize,
+				Bytef *tar, uLongf* tsize,
+				const Bytef *delta, uLong dsize)
+{
+  int rval;
+
+  /* init io buffers */
+  strm->base[0]       = (Bytef*) ref;
+  strm->base_avail[0] = rsize;
+  strm->refnum        = 1;
+
+  strm->next_out  = (Bytef*) tar;
+  strm->total_out = 0;
+  strm->avail_out = *tsize;
+
+  strm->next_in  = (Bytef*) delta;
+  strm->total_in = 0;
+  strm->avail_in = dsize;
+
+  /* allocate the state on the first call, reset it afterwards */
+  if (strm->state == ZD_NULL)
+  {
+    strm->zalloc = (alloc_func)0;
+    strm->zfree  = (free_func)0;
+    strm->opaque = (voidpf)0;
+    rval = zd_inflateInit(strm);
+  }
+  else
+  {
+    rval = zd_inflateReset(strm);
+#ifdef ZD_LARGE_WINDOW
+    /* the window is too small for this delta; get a larger one */
+    if (rval == ZD_BUF_ERROR)
+    {
+      zd_inflateEnd(strm);
+      rval = zd_inflateInit(strm);
+    }
+#endif
+  }
+  if (rval != ZD_OK)
+  {
+    fprintf(stderr, "%s error: %d\n", "zd_InflateInit", rval);
+    return rval;
+  }
+
+  /* decompress the data */
+  rval = zd_inflate(strm,ZD_FINISH);
+  if(rval != ZD_STREAM_END){
+    return rval;
+  }
+  *tsize = strm->total_out;
+  return ZD_OK;
+}
+
 /*
  * same as above but with dynamic memory allocation
  */
@@ -426,6 +426,16 @@ ZEXTERN int ZEXPORT zd_inflateReset OF((zd_streamp strm));
    stream state was inconsistent (such as zalloc or state being NULL).
 */
 
+ZEXTERN int ZEXPORT zd_deflateResetKeepRef OF((zd_streamp strm));
+/*
+     Same as zd_deflateReset, for a caller that passes the same reference
+   data as in the previous compression. A reference that fit entirely in
+   the reference window keeps its window and hash chains, so only the new
+   target is read. Any other reference is read and hashed as usual. The
+   caller must still set base, base_avail and refnum as for
+   zd_deflateReset.
+*/
+
 /* ==========================================================================
  * utility functions  
  */
@@ -515,6 +525,23 @@ ZEXTERN int ZEXPORT zd_compressN OF ((const Bytef *ref[],uLong rsize[],int rw,
 
 
 
+/* same as zd_compress, but the compression state lives in a stream
+ * owned by the caller and is reset instead of reallocated between calls
+ *
+ * INPUT:
+ * strm     stream kept by the caller; zero it before the first call and
+ *          release it with zd_deflateEnd after the last one
+ * keep_ref non zero if ref holds the same data as in the previous call;
+ *          its hash chains are then reused (see zd_deflateResetKeepRef)
+ * the rest as for zd_compress
+ *
+ * zd_compress_reuse returns the same codes as zd_compress
+ */
+ZEXTERN int ZEXPORT zd_compress_reuse OF ((zd_streamp strm, int keep_ref,
+					   const Bytef *ref, uLong rsize,
+					   const Bytef *tar, uLong tsize,
+					   Bytef *delta, uLongf* dsize));
+
 /* rebuilds target data from reference data and zdelta difference
  *
  * INPUT:
@@ -541,6 +568,21 @@ ZEXTERN int ZEXPORT zd_uncompress OF ((const Bytef *ref, uLong rsize,
 				       const Bytef *delta, uLong dsize));
 
 
+/* same as zd_uncompress, but the decompression state lives in a stream
+ * owned by the caller and is reset instead of reallocated between calls
+ *
+ * INPUT:
+ * strm     stream kept by the caller; zero it before the first call and
+ *          release it with zd_inflateEnd after the last one
+ * the rest as for zd_uncompress
+ *
+ * zd_uncompress_reuse returns the same codes as zd_uncompress
+ */
+ZEXTERN int ZEXPORT zd_uncompress_reuse OF ((zd_streamp strm,
+					     const Bytef *ref, uLong rsize,
+					     Bytef *tar, uLongf *tsize,
+					     const Bytef *delta, uLong dsize));
+
 /* rebuilds target data from reference data and zdelta difference
  *
  * INPUT:
@@ -67,6 +67,15 @@ extern const char *zd_z_errmsg[9]; /* indexed by 2-zlib_error */
 #endif
 /* default windowBits for decompression. MAX_WBITS is for compression only */
 
+#ifdef ZD_LARGE_WINDOW
+#  define WBITS_BASE 9
+#else
+#  define WBITS_BASE 8
+#endif
+/* zdelta: smallest windowBits. The header keeps windowBits-WBITS_BASE in
+ * four bits, so the large window build moves the range up to 9..24
+ */
+
 #if MAX_MEM_LEVEL >= 8
 #  define DEF_MEM_LEVEL 8
 #else